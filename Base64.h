@@ -0,0 +1,190 @@
+/**
+ * Author: Ethan Dickey
+ *
+ * Base64 (RFC 4648, padded) encoder/decoder used by JSON_File::print_binary.
+ * The encoder has AVX2 and SSSE3 paths (picked at compile time from -mavx2/-mssse3 or -march)
+ * with a scalar fallback, so it always builds with a plain "g++ -std=c++11".
+ */
+#ifndef BASE64_H
+#define BASE64_H
+
+#include <cstddef>
+#include <vector>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSSE3__)
+    #include <tmmintrin.h>
+#endif
+
+namespace base64 {
+
+static const char ENCODE_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * Description: number of characters needed to encode len bytes (padding included)
+ */
+inline size_t encoded_length(size_t len){ return (len + 2) / 3 * 4; }
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+/**
+ * SIMD helpers (Wojciech Mula's pshufb method).  Each 128 bit lane turns 12 input bytes
+ * into 16 six-bit indices, then maps the indices onto the alphabet with one shuffle.
+ */
+inline __m128i lookup_ssse3(__m128i indices){
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+    const __m128i shift = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                        '/' - 63, 'A', 0, 0);
+    result = _mm_shuffle_epi8(shift, result);
+    return _mm_add_epi8(result, indices);
+}
+inline __m128i split_ssse3(__m128i in){
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+#endif
+
+#if defined(__AVX2__)
+inline __m256i lookup_avx2(__m256i indices){
+    __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+
+    const __m256i shift = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                           '/' - 63, 'A', 0, 0,
+                                           'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                           '/' - 63, 'A', 0, 0);
+    result = _mm256_shuffle_epi8(shift, result);
+    return _mm256_add_epi8(result, indices);
+}
+inline __m256i split_avx2(__m256i in){
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+}
+#endif
+
+/**
+ * Description: encodes len bytes of src into dst (no null terminator).  dst must have room
+ *              for encoded_length(len) characters.  The SIMD loops never read past src + len.
+ *
+ * @param  src  : raw bytes
+ * @param  len  : number of bytes in src
+ * @param  dst  : output characters
+ * @return size_t : number of characters written
+ */
+inline size_t encode(const void* src, size_t len, char* dst){
+    const unsigned char* in = static_cast<const unsigned char*>(src);
+    char* o = dst;
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    //24 bytes in, 32 chars out (the second lane loads 16 bytes starting at +12)
+    for(; i + 28 <= len; i += 24, o += 32){
+        __m256i v = _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in + i)));
+        v = _mm256_inserti128_si256(v, _mm_loadu_si128((const __m128i*)(in + i + 12)), 1);
+        _mm256_storeu_si256((__m256i*)o, lookup_avx2(split_avx2(v)));
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSSE3__)
+    //12 bytes in, 16 chars out
+    for(; i + 16 <= len; i += 12, o += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        _mm_storeu_si128((__m128i*)o, lookup_ssse3(split_ssse3(v)));
+    }
+#endif
+
+    //scalar fallback / tail
+    for(; i + 3 <= len; i += 3){
+        unsigned int triple = (in[i] << 16) | (in[i+1] << 8) | in[i+2];
+        *o++ = ENCODE_TABLE[(triple >> 18) & 0x3f];
+        *o++ = ENCODE_TABLE[(triple >> 12) & 0x3f];
+        *o++ = ENCODE_TABLE[(triple >> 6) & 0x3f];
+        *o++ = ENCODE_TABLE[triple & 0x3f];
+    }
+    if(i < len){
+        unsigned int triple = in[i] << 16;
+        if(i + 1 < len) triple |= in[i+1] << 8;
+
+        *o++ = ENCODE_TABLE[(triple >> 18) & 0x3f];
+        *o++ = ENCODE_TABLE[(triple >> 12) & 0x3f];
+        *o++ = (i + 1 < len ? ENCODE_TABLE[(triple >> 6) & 0x3f] : '=');
+        *o++ = '=';
+    }
+
+    return o - dst;
+}
+
+/**
+ * Description: decodes base64 text (as written by encode()) and appends the bytes to out.
+ *              Whitespace is not allowed; padding is optional, but if it's there it has to
+ *              be the one or two '=' that make the length a multiple of 4.
+ *
+ * @param  src  : base64 characters (no quotes)
+ * @param  len  : number of characters
+ * @param  out  : decoded bytes are appended here
+ * @return bool : false if src is not valid base64 (out is left partially filled)
+ */
+inline bool decode(const char* src, size_t len, std::vector<unsigned char>& out){
+    //-1 = invalid character (built once, thread safe as a function-local static)
+    struct DecodeTable {
+        signed char t[256];
+        DecodeTable(){
+            for(int i=0;i<256;i++){ t[i] = -1; }
+            for(int i=0;i<64;i++){ t[(unsigned char)ENCODE_TABLE[i]] = i; }
+        }
+    };
+    static const DecodeTable decodeTable;
+    const signed char* table = decodeTable.t;
+
+    //strip padding: at most two '=', and only to make up a whole group of 4
+    size_t padding = 0;
+    while(padding < 2 && len > 0 && src[len-1] == '='){ len--; padding++; }
+    if(padding > 0 && (len + padding) % 4 != 0){ return false; }
+    if(len % 4 == 1){ return false; }
+
+    out.reserve(out.size() + len / 4 * 3 + 2);
+
+    size_t i = 0;
+    for(; i + 4 <= len; i += 4){
+        int a = table[(unsigned char)src[i]],   b = table[(unsigned char)src[i+1]],
+            c = table[(unsigned char)src[i+2]], d = table[(unsigned char)src[i+3]];
+        if((a | b | c | d) < 0){ return false; }
+
+        unsigned int triple = (a << 18) | (b << 12) | (c << 6) | d;
+        out.push_back((triple >> 16) & 0xff);
+        out.push_back((triple >> 8) & 0xff);
+        out.push_back(triple & 0xff);
+    }
+
+    //2 or 3 leftover characters -> 1 or 2 bytes
+    if(i < len){
+        int a = table[(unsigned char)src[i]], b = table[(unsigned char)src[i+1]];
+        int c = (i + 2 < len ? table[(unsigned char)src[i+2]] : 0);
+        if((a | b | c) < 0){ return false; }
+
+        unsigned int triple = (a << 18) | (b << 12) | (c << 6);
+        out.push_back((triple >> 16) & 0xff);
+        if(i + 2 < len){ out.push_back((triple >> 8) & 0xff); }
+    }
+
+    return true;
+}
+
+}//namespace base64
+
+#endif
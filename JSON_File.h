@@ -1,32 +1,173 @@
 /**
  * Author: Ethan Dickey
  */
+#ifndef JSON_FILE_H
+#define JSON_FILE_H
+
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <stack>
 #include <vector>
+#include <deque>
+#include <set>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <tuple>
+#include <utility>
 #include <typeinfo>
+#include <cstddef>
+#if __cplusplus >= 201703L
+    #include <optional>
+    #include <variant>
+#endif
+#include "Base64.h"
+#include "JSON_Hash.h"
 
 #define endl '\n'
 
+//Set to 1 (e.g. -DJSON_FILE_STATS=1) to compile in writer statistics -- see JSON_Stats.h and stats()
+#ifndef JSON_FILE_STATS
+    #define JSON_FILE_STATS 0
+#endif
+#if JSON_FILE_STATS
+    #include "JSON_Stats.h"
+    #define JSON_FILE_STAT(x) x
+#else
+    #define JSON_FILE_STAT(x)
+#endif
+
 using namespace std;
 
+template <class... Ts>
+class JSON_Columns;
+
 class JSON_File {
+public:
+    //What canonical mode does when a key is written twice in the same object
+    enum DUPLICATE_KEYS { DUPLICATES_ALLOW, DUPLICATES_THROW };
+
 private:
+    template <class... Ts>
+    friend class JSON_Columns;//writes its batches straight into out
+
     bool comma, initialized;
-    ofstream out;//output stream
+#if JSON_FILE_STATS
+    json_stats::ofstream out;//output stream (also counts bytes, flushes and time spent writing)
+    json_stats::Stats counters;//token counts, depth and top level keys (stats() fills in the rest)
+    unsigned long long topKeyStart;//byte offset where the current top level key started
+    string statsFile;//periodic dump (dump_stats_every)
+    double statsInterval;
+    json_stats::clock::time_point nextDump;
+
+    void stat_top_key(const string& name);
+    void stat_depth(){ if((int)brackets.size() > counters.maxDepth) counters.maxDepth = brackets.size(); }
+    void stat_schedule_dump(){ nextDump = json_stats::clock::now() + chrono::duration_cast<json_stats::clock::duration>(chrono::duration<double>(statsInterval)); }
+    static void stat_on_flush(void* self);
+#else
+    json_hash::ofstream out;//output stream (an ofstream that can hash what it writes)
+#endif
     stack<char> brackets;//keeps track in case of mass closing and also as a safeguard for wrongful closing (object for array, etc.)
     int currDepth;//increments by 2 -- the true padding number in spaces (as opposed to true depth, which is half)
     int lowestArrayDepth;
 
+    //Canonical mode (set_canonical)
+    bool canonical;
+    DUPLICATE_KEYS duplicates;
+    size_t sortLimit;//0 = keys in the order they were written
+    vector<set<string> > keys;//keys seen in each open object (root first), only kept for DUPLICATES_THROW
+    //An object whose members are being buffered so they can be sorted.  out writes the member
+    //being written straight into it; once the object gets bigger than sortLimit it spills (the
+    //members so far go to sink sorted, the unfinished one after them) and from then on it just
+    //passes everything through to sink, so no more than sortLimit bytes are held per object.
+    class Capture : public streambuf {
+    public:
+        int level;//brackets.size() inside the object
+        streambuf* sink;//where the object's text goes (the file, or the Capture of the object it's in)
+        bool spilled;
+
+        Capture(int l, streambuf* s, size_t lim): level(l), sink(s), spilled(false), limit(lim), bytes(0), inMember(false) {}
+
+        void begin_member(const string& name);
+        void finish_member();
+        void spill();
+        void close();
+
+    protected:
+        int_type overflow(int_type c);
+        streamsize xsputn(const char* s, streamsize n);
+
+    private:
+        size_t limit, bytes;//bytes = size of the finished members
+        vector<pair<string, string> > members;
+        bool inMember;//members.back() is still being written
+
+        void flush_members();
+    };
+    deque<Capture> captures;//deque so out can point at a Capture's buffer while more are added
+    unsigned long long lastHash;
+
+    void begin_key(const string& name);
+    void print_name(const string& name);
+    void print_escaped(const char* val, size_t len);
+    void capture_open();
+    void capture_close();
+
+    template <class T>
+    void print_data(const vector<T>& data, bool tabs);
+    void print_type(string val) {
+        JSON_FILE_STAT(counters.strings++;)
+        if(canonical) print_escaped(val.data(), val.size());
+        else out << "\"" << val << "\"";
+    }
+    void print_type(const char* val) {
+        JSON_FILE_STAT(counters.strings++;)
+        if(canonical) print_escaped(val, strlen(val));
+        else out << "\"" << val << "\"";
+    }
+    void print_type(bool val) { JSON_FILE_STAT(counters.bools++;) out << (val == true ? "true" : "false"); }
+    void print_type(double val) {
+        JSON_FILE_STAT(counters.doubles++;)
+        if(canonical){ char buffer[32]; out.write(buffer, format_double(val, buffer)); }
+        else out << val;
+    }
+    void print_type(int val) {
+        JSON_FILE_STAT(counters.ints++;)
+        if(canonical){ char buffer[16]; out.write(buffer, snprintf(buffer, sizeof(buffer), "%d", val)); }
+        else out << val;
+    }
+    void print_type(long long val) {
+        JSON_FILE_STAT(counters.ints++;)
+        if(canonical){ char buffer[24]; out.write(buffer, snprintf(buffer, sizeof(buffer), "%lld", val)); }
+        else out << val;
+    }
+    void print_type(nullptr_t) { JSON_FILE_STAT(counters.nulls++;) out << "null"; }
+    void print_type_binary(const void* data, size_t len);
+
+    //Tuples/pairs are printed inline as a sub array, [a, b, ...] (all picked at compile time)
+    template <class A, class B>
+    void print_type(const pair<A, B>& val);
+    template <class... Ts>
+    void print_type(const tuple<Ts...>& val);
+    template <size_t I, class... Ts>
+    typename enable_if<I == sizeof...(Ts)>::type print_tuple(const tuple<Ts...>&) {}
+    template <size_t I, class... Ts>
+    typename enable_if<(I < sizeof...(Ts))>::type print_tuple(const tuple<Ts...>& val);
+#if __cplusplus >= 201703L
+    //Empty optional = null, variant = whichever alternative it holds
     template <class T>
-    void print_data(vector<T> data, bool tabs);
-    void print_type(string val) { out << "\"" << val << "\""; }
-    void print_type(const char* val) { out << "\"" << val << "\""; }
-    void print_type(bool val) { out << (val == true ? "true" : "false"); }
-    void print_type(double val) { out << val; }
-    void print_type(int val) { out << val; }
+    void print_type(const optional<T>& val) { if(val) print_type(*val); else print_type(nullptr); }
+    template <class... Ts>
+    void print_type(const variant<Ts...>& val) { visit([this](const auto& v){ this->print_type(v); }, val); }
+#endif
+    //Comma separated values with no state checks in between (print_values)
+    template <class T>
+    void print_list(const T& last) { print_type(last); }
+    template <class T, class... Ts>
+    void print_list(const T& first, const Ts&... rest) { print_type(first); out << ", "; print_list(rest...); }
     // template <class T>
     // void print_type(T val) { out << val; }
 
@@ -54,9 +195,25 @@ public:
         NOT_INITIALIZED_ERROR(string m): message(m) {}
         const char* what() const throw(){ return message.c_str(); }//for c++
     };
+    struct COLUMN_COUNT_ERROR : public exception {
+        string message;
+
+        COLUMN_COUNT_ERROR(string m): message(m) {}
+        const char* what() const throw(){ return message.c_str(); }//for c++
+    };
+    struct DUPLICATE_KEY_ERROR : public exception {
+        string message;
+
+        DUPLICATE_KEY_ERROR(string m): message(m) {}
+        const char* what() const throw(){ return message.c_str(); }//for c++
+    };
 
-    JSON_File(): comma(false), initialized(false), currDepth(-1), lowestArrayDepth(-1) {}
-    JSON_File(string filename): initialized(false) {//redundant safeguard with initialization
+    JSON_File(): comma(false), initialized(false), currDepth(-1), lowestArrayDepth(-1),
+                 canonical(false), duplicates(DUPLICATES_ALLOW), sortLimit(0), lastHash(0) {
+        JSON_FILE_STAT(statsInterval = 0; out.file().set_on_flush(&JSON_File::stat_on_flush, this);)
+    }
+    JSON_File(string filename): initialized(false), canonical(false), duplicates(DUPLICATES_ALLOW), sortLimit(0), lastHash(0) {//redundant safeguard with initialization
+        JSON_FILE_STAT(statsInterval = 0; out.file().set_on_flush(&JSON_File::stat_on_flush, this);)
         this->open(filename);
     }
 
@@ -76,9 +233,37 @@ public:
     /**
      * Description: closes the file
      *
+     * @return unsigned long long : XXH64 of everything written if set_hashing(true), else 0
+     */
+    unsigned long long close();
+
+    /**
+     * Description: canonical output (call before open()).  Numbers are formatted the same way
+     *              regardless of stream state or locale (shortest of %.15g-%.17g that reads back
+     *              exactly, no NaN/Inf -- they become null), strings and keys are escaped, and
+     *              the duplicate key policy is enforced.  With sortKeysUpTo > 0 every object's
+     *              members are buffered and written sorted by key (bytewise), as long as the
+     *              object stays under that many bytes; past that the rest of it is streamed in
+     *              write order.
+     *
+     * @param  on           : canonical mode on/off
+     * @param  policy       : DUPLICATES_THROW (DUPLICATE_KEY_ERROR) or DUPLICATES_ALLOW
+     * @param  sortKeysUpTo : biggest object (bytes) whose keys get sorted, 0 = don't sort
      * @return void
      */
-    void close();
+    void set_canonical(bool on, DUPLICATE_KEYS policy = DUPLICATES_THROW, size_t sortKeysUpTo = 0);
+    /**
+     * Description: hash the file (XXH64) as it is written, returned by close() (call before open())
+     *
+     * @param  on : hashing on/off
+     * @return void
+     */
+    void set_hashing(bool on);
+    //Hash returned by the last close() (0 if hashing was off)
+    unsigned long long hash(){ return lastHash; }
+
+    //Canonical number formatting (used by canonical mode), buffer needs 32 chars
+    static size_t format_double(double val, char* buffer);
 
     JSON_File& open_object(string name);
     void close_object();
@@ -107,9 +292,108 @@ public:
     template <class T>
     JSON_File& print_element(string name, T val);
 
+    //Print several values of any (supported) types into the current array in one call
+    template <class T, class... Ts>
+    JSON_File& print_values(const T& first, const Ts&... rest);
+
+    //Raw bytes as a base64 string (decode with base64::decode)
+    JSON_File& print_binary(string name, const void* data, size_t len);
+    //Same, but as an element of the current array (like print_data)
+    JSON_File& print_binary(const void* data, size_t len);
+
     void close_until(int levelNonInclusive);
     int getCurrentLevel(){ return brackets.size();}
     bool isInitialized(){ return initialized; }
+
+#if JSON_FILE_STATS
+    /**
+     * Description: snapshot of the writer statistics since open()
+     *
+     * @return json_stats::Stats : copy of the counters
+     */
+    json_stats::Stats stats();
+    /**
+     * Description: writes stats() to a JSON side file (".json" is appended like open()).
+     *              Never throws (it runs from inside the output buffer's flush): if the side
+     *              file can't be opened nothing is written and stats().failedDumps goes up.
+     *
+     * @param  filename : the file name
+     * @return bool : whether the side file was written
+     */
+    bool dump_stats(string filename);
+    /**
+     * Description: rewrite the side file at most every `seconds` (checked whenever the
+     *              output buffer is flushed) and once more on close().  Empty filename = off.
+     *
+     * @param  filename : the file name
+     * @param  seconds  : minimum time between dumps
+     * @return void
+     */
+    void dump_stats_every(string filename, double seconds);
+#endif
+};
+
+/**
+ * Columnar (struct of arrays) output for lots of records of the same shape.  Rows are
+ * buffered per column and every batchSize rows one batch is written as
+ *
+ *     {"cols": ["a", "b"], "data": {"a": [...], "b": [...]}}
+ *
+ * into the array `name`, so each column goes through print_data in one go and the keys are
+ * written once per batch instead of once per record.  Don't write anything else to the
+ * JSON_File until close() (the destructor closes too).  Column names are keys: they're
+ * escaped in canonical mode, "data" is in sorted key order when keys are sorted, and a
+ * name given twice throws DUPLICATE_KEY_ERROR.  The batches are the one place objects go in an
+ * array: OBJECT_IN_ARRAY_ERROR keeps hand-written ones out, these are written directly, with
+ * the same bracket and depth bookkeeping (and stats) as open_object/open_array.
+ *
+ *     JSON_Columns<int, string, double> cols(json, "records", {"id", "name", "score"});
+ *     cols.add(1, "one", 1.5).add(2, "two", 2.5);
+ *     cols.close();
+ */
+template <class... Ts>
+class JSON_Columns {
+private:
+    JSON_File& json;
+    vector<string> names;
+    tuple<vector<Ts>...> columns;
+    size_t batchSize, rows;
+    bool opened;
+
+    template <size_t I, class T, class... Rest>
+    void push(const T& val, const Rest&... rest){ get<I>(columns).push_back(val); push<I + 1>(rest...); }
+    template <size_t I>
+    void push(){}
+
+    //One printer per column, called in key order (sorted when the JSON_File sorts keys)
+    typedef void (JSON_Columns::*Printer)(const string& depth);
+    vector<Printer> printers;
+
+    template <size_t I>
+    typename enable_if<I == sizeof...(Ts)>::type add_printers(){}
+    template <size_t I>
+    typename enable_if<(I < sizeof...(Ts))>::type add_printers(){ printers.push_back(&JSON_Columns::print_column<I>); add_printers<I + 1>(); }
+    template <size_t I>
+    void print_column(const string& depth);
+    void enter(char bracket);
+    void leave();
+
+public:
+    JSON_Columns(JSON_File& file, string name, vector<string> columnNames, size_t rowsPerBatch = 4096);
+    ~JSON_Columns(){
+        if(opened && json.isInitialized()){
+            this->close();
+        }
+    }
+
+    //Buffer one record (one value per column, in column order)
+    JSON_Columns& add(const Ts&... vals);
+    //Write out the buffered rows as one batch (called automatically every batchSize rows)
+    void flush();
+    //Flush and close the array
+    void close();
+
+    size_t buffered(){ return rows; }
 };
 
 
@@ -128,6 +412,7 @@ bool JSON_File::open(string filename){
         currDepth = 2;
         lowestArrayDepth = -1;
         initialized = false;
+        JSON_FILE_STAT(counters = json_stats::Stats(); topKeyStart = 0; stat_schedule_dump();)
 
         //Append .json to the end of the file
         if(filename.length() < 5 || filename.substr(filename.length()-5, 5) != ".json"){
@@ -140,6 +425,10 @@ bool JSON_File::open(string filename){
             out << "{\n";
 
             initialized = true;
+
+            keys.assign(duplicates == DUPLICATES_THROW ? 1 : 0, set<string>());
+            captures.clear();
+            capture_open();
         }
     } else {
         throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::open() FILE ALREADY OPEN");
@@ -148,27 +437,34 @@ bool JSON_File::open(string filename){
     //Return success?
     return initialized;
 }
-void JSON_File::close(){
+unsigned long long JSON_File::close(){
     if(initialized){
         //Close all preceeding brackets
         close_until(0);
+        capture_close();//root object
 
         //Safeguard
         initialized = false;
 
         //Print the last closing bracket
+        JSON_FILE_STAT(stat_top_key("");)
         out << "\n}\n";
 
         //Close the file
         out.close();
+        lastHash = (out.file().is_hashing() ? out.file().hash() : 0);
+        JSON_FILE_STAT(if(!statsFile.empty()) dump_stats(statsFile);)
 
         //Clean up
         comma = false;
         currDepth = -1;
         lowestArrayDepth = -1;
+        keys.clear();
     } else {
         throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::close() WITHOUT INITIALIZING");
     }
+
+    return lastHash;
 }
 
 /**
@@ -182,13 +478,19 @@ JSON_File& JSON_File::open_object(string name){
 
         string depth(currDepth, ' ');
 
+        begin_key(name);
         if(comma) out << ",\n";
 
-        out << depth << "\"" << name << "\": {\n";
+        out << depth;
+        print_name(name);
+        out << ": {\n";
 
         currDepth += 2;
         comma = false;
         brackets.push('}');
+        JSON_FILE_STAT(counters.objects++; stat_depth();)
+        if(duplicates == DUPLICATES_THROW) keys.push_back(set<string>());
+        capture_open();
     } else {
         throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::open_object() WITHOUT INITIALIZING");
     }
@@ -199,6 +501,8 @@ void JSON_File::close_object(){
     if(initialized){
         if(brackets.top() != '}'){ throw new WRONGFUL_CLOSING_ERROR('}', "Need '}' in JSON_File::close_object ");}
 
+        capture_close();
+        if(duplicates == DUPLICATES_THROW) keys.pop_back();
         currDepth -= 2;
 
         string depth(currDepth, ' ');
@@ -218,13 +522,17 @@ JSON_File& JSON_File::open_array(string name){
         }
         string depth(currDepth, ' ');
 
+        begin_key(name);
         if(comma) out << ",\n";
-        out << depth << "\"" << name << "\": [\n";
+        out << depth;
+        print_name(name);
+        out << ": [\n";
 
         currDepth += 2;
         comma = false;
         brackets.push(']');
         if(lowestArrayDepth == -1){ lowestArrayDepth = brackets.size(); }
+        JSON_FILE_STAT(counters.arrays++; stat_depth();)
     } else {
         throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::open_array() WITHOUT INITIALIZING");
     }
@@ -258,6 +566,7 @@ JSON_File& JSON_File::open_sub_array(){
         comma = false;
         brackets.push(']');
         if(lowestArrayDepth == -1){ lowestArrayDepth = brackets.size(); }
+        JSON_FILE_STAT(counters.subArrays++; stat_depth();)
     } else {
         throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::open_sub_array() WITHOUT INITIALIZING");
     }
@@ -294,7 +603,7 @@ JSON_File& JSON_File::print_data(vector<T> data){//<vector<T>>
 // void JSON_File::print_type(int val) { out << data[i]; }
 
 template <class T>
-void JSON_File::print_data(vector<T> data, bool tabs){
+void JSON_File::print_data(const vector<T>& data, bool tabs){
     if(initialized){
         //tabs and newline
         string depth(currDepth, ' ');
@@ -345,9 +654,12 @@ JSON_File& JSON_File::print_element(string name, T val){
     if(initialized){
         //tabs and newline
         string depth(currDepth, ' ');
+        begin_key(name);
         if(comma) out << ",\n";
         //name
-        out << depth << "\"" << name << "\": ";
+        out << depth;
+        print_name(name);
+        out << ": ";
 
         //This auto selects the correct overloaded function for the job at runtime with templated parameters :)
         print_type(val);
@@ -360,11 +672,115 @@ JSON_File& JSON_File::print_element(string name, T val){
     return *this;
 }
 
+/**
+ * Heterogeneous values (tuples, pairs, print_values)
+ */
+template <class A, class B>
+void JSON_File::print_type(const pair<A, B>& val){
+    JSON_FILE_STAT(counters.subArrays++;)
+    out << "[";
+    print_type(val.first);
+    out << ", ";
+    print_type(val.second);
+    out << "]";
+}
+
+template <class... Ts>
+void JSON_File::print_type(const tuple<Ts...>& val){
+    JSON_FILE_STAT(counters.subArrays++;)
+    out << "[";
+    print_tuple<0>(val);
+    out << "]";
+}
+template <size_t I, class... Ts>
+typename enable_if<(I < sizeof...(Ts))>::type JSON_File::print_tuple(const tuple<Ts...>& val){
+    if(I != 0) out << ", ";
+    print_type(get<I>(val));
+    print_tuple<I + 1>(val);
+}
+
+template <class T, class... Ts>
+JSON_File& JSON_File::print_values(const T& first, const Ts&... rest){
+    if(initialized){
+        //tabs and newline (decided once for the whole row)
+        string depth(currDepth, ' ');
+        if(comma) out << ", ";
+        else out << depth;
+
+        print_list(first, rest...);
+
+        comma = true;
+    } else {
+        throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::print_values() WITHOUT INITIALIZING");
+    }
+
+    return *this;//chaining
+}
+
+/**
+ * Binary (base64) functions
+ */
+void JSON_File::print_type_binary(const void* data, size_t len){
+    //Encode in blocks straight into the stream (block size is a multiple of 3 so only the last one pads)
+    const size_t BLOCK = 3072;
+    char buffer[BLOCK / 3 * 4];
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    JSON_FILE_STAT(counters.binaries++;)
+
+    out << '"';
+    for(size_t i=0;i<len;i+=BLOCK){
+        size_t n = (len - i < BLOCK ? len - i : BLOCK);
+        out.write(buffer, base64::encode(bytes + i, n, buffer));
+    }
+    out << '"';
+}
+
+JSON_File& JSON_File::print_binary(string name, const void* data, size_t len){
+    if(initialized){
+        //tabs and newline
+        string depth(currDepth, ' ');
+        begin_key(name);
+        if(comma) out << ",\n";
+        //name
+        out << depth;
+        print_name(name);
+        out << ": ";
+
+        print_type_binary(data, len);
+
+        comma = true;
+    } else {
+        throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::print_binary() WITHOUT INITIALIZING");
+    }
+
+    return *this;//chaining
+}
+JSON_File& JSON_File::print_binary(const void* data, size_t len){
+    if(initialized){
+        //tabs and newline
+        string depth(currDepth, ' ');
+        if(comma) out << ", ";
+        else out << depth;
+
+        print_type_binary(data, len);
+
+        comma = true;
+    } else {
+        throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::print_binary(array element) WITHOUT INITIALIZING");
+    }
+
+    return *this;//chaining
+}
+
 void JSON_File::close_until(int levelNonInclusive){
     if(initialized){
         if(0 <= levelNonInclusive && levelNonInclusive < brackets.size()){
             string depth;
             while(levelNonInclusive < brackets.size()){//what if we're inside a sub_array
+                if(brackets.top() == '}'){
+                    capture_close();
+                    if(duplicates == DUPLICATES_THROW) keys.pop_back();
+                }
                 if(brackets.top() == '}' || lowestArrayDepth == brackets.size()){//if it's not a sub-array
                     currDepth -= 2;
                     depth.resize(currDepth, ' ');
@@ -382,3 +798,366 @@ void JSON_File::close_until(int levelNonInclusive){
         throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::close_until() WITHOUT INITIALIZING");
     }
 }
+
+/**
+ * Canonical mode and hashing
+ */
+void JSON_File::set_canonical(bool on, DUPLICATE_KEYS policy, size_t sortKeysUpTo){
+    if(initialized){ throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::set_canonical() WHILE A FILE IS OPEN"); }
+
+    canonical = on;
+    duplicates = (on ? policy : DUPLICATES_ALLOW);
+    sortLimit = (on ? sortKeysUpTo : 0);
+}
+void JSON_File::set_hashing(bool on){
+    if(initialized){ throw new NOT_INITIALIZED_ERROR("CALLED JSON_File::set_hashing() WHILE A FILE IS OPEN"); }
+
+    out.file().set_hashing(on);
+}
+
+size_t JSON_File::format_double(double val, char* buffer){
+    if(!std::isfinite(val)){ memcpy(buffer, "null", 4); return 4; }
+    if(val == 0){ buffer[0] = '0'; return 1; }//-0 too
+
+    int len;
+    if(fabs(val) < 1e15 && val == floor(val)){
+        len = snprintf(buffer, 32, "%.0f", val);
+    } else {
+        for(int precision=15;precision<=17;precision++){
+            len = snprintf(buffer, 32, "%.*g", precision, val);
+            if(strtod(buffer, 0) == val) break;
+        }
+    }
+
+    //whatever the C locale says, JSON wants a '.'
+    for(int i=0;i<len;i++){ if(buffer[i] == ',') buffer[i] = '.'; }
+    return len;
+}
+
+//Every key goes through here before its comma is written
+void JSON_File::begin_key(const string& name){
+    JSON_FILE_STAT(if(brackets.empty()) stat_top_key(name);)
+
+    if(duplicates == DUPLICATES_THROW && !keys.empty()){
+        if(!keys.back().insert(name).second){
+            throw new DUPLICATE_KEY_ERROR("DUPLICATE KEY \"" + name + "\" IN JSON_File (canonical mode)");
+        }
+    }
+
+    //A new member of an object we're sorting: give it its own buffer
+    if(!captures.empty() && captures.back().level == (int)brackets.size()){
+        Capture& c = captures.back();
+        if(c.spilled){//too big to sort, members are streamed as they come
+            out.rdbuf(c.sink);
+            return;
+        }
+
+        c.begin_member(name);
+        out.rdbuf(&c);
+        comma = false;
+    }
+}
+
+void JSON_File::print_name(const string& name){
+    if(canonical) print_escaped(name.data(), name.size());
+    else out << "\"" << name << "\"";
+}
+
+void JSON_File::print_escaped(const char* val, size_t len){
+    static const char hex[] = "0123456789abcdef";
+
+    out << '"';
+    size_t start = 0;
+    for(size_t i=0;i<len;i++){
+        unsigned char c = val[i];
+        if(c != '"' && c != '\\' && c >= 0x20) continue;
+
+        out.write(val + start, i - start);
+        switch(c){
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\b': out << "\\b"; break;
+            case '\f': out << "\\f"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:   out << "\\u00" << hex[c >> 4] << hex[c & 0xf]; break;
+        }
+        start = i + 1;
+    }
+    out.write(val + start, len - start);
+    out << '"';
+}
+
+void JSON_File::Capture::begin_member(const string& name){
+    finish_member();
+    members.push_back(make_pair(name, string()));
+    inMember = true;
+}
+
+void JSON_File::Capture::finish_member(){
+    if(inMember){
+        bytes += members.back().second.size();
+        inMember = false;
+    }
+}
+
+//Sorted members, comma separated, into sink
+void JSON_File::Capture::flush_members(){
+    stable_sort(members.begin(), members.end(),
+                [](const pair<string, string>& a, const pair<string, string>& b){ return a.first < b.first; });
+
+    for(int i=0;i<members.size();i++){
+        if(i != 0) sink->sputn(",\n", 2);
+        sink->sputn(members[i].second.data(), members[i].second.size());
+    }
+    members.clear();
+}
+
+//Over the limit: the finished members go out sorted, then what there is of the one being
+//written, and everything after that is passed straight through
+void JSON_File::Capture::spill(){
+    string partial;
+    if(inMember){
+        partial.swap(members.back().second);
+        members.pop_back();
+    }
+
+    bool any = !members.empty();
+    flush_members();
+    if(inMember){
+        if(any) sink->sputn(",\n", 2);
+        sink->sputn(partial.data(), partial.size());
+        inMember = false;
+    }
+    spilled = true;
+}
+
+void JSON_File::Capture::close(){
+    finish_member();
+    if(!spilled) flush_members();
+}
+
+JSON_File::Capture::int_type JSON_File::Capture::overflow(int_type c){
+    if(traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+
+    char ch = traits_type::to_char_type(c);
+    xsputn(&ch, 1);
+    return c;
+}
+
+streamsize JSON_File::Capture::xsputn(const char* s, streamsize n){
+    if(spilled) return sink->sputn(s, n);
+
+    members.back().second.append(s, n);
+    if(bytes + members.back().second.size() > limit) spill();
+    return n;
+}
+
+//Called right after an object's '{' (or the file's) is written
+void JSON_File::capture_open(){
+    if(sortLimit > 0){
+        captures.emplace_back(brackets.size(), out.rdbuf(), sortLimit);
+    }
+}
+//Called right before an object's '}' (or the file's) is written
+void JSON_File::capture_close(){
+    if(!captures.empty() && captures.back().level == (int)brackets.size()){
+        Capture& c = captures.back();
+        c.close();
+        out.rdbuf(c.sink);
+        captures.pop_back();
+    }
+}
+
+#if JSON_FILE_STATS
+/**
+ * Statistics functions
+ */
+//Closes off the byte count of the previous top level key and starts a new one ("" = just close off)
+void JSON_File::stat_top_key(const string& name){
+    unsigned long long now = out.file().bytes();
+    if(!counters.topLevelBytes.empty()){ counters.topLevelBytes.back().second = now - topKeyStart; }
+    if(!name.empty()){ counters.topLevelBytes.push_back(make_pair(name, 0ULL)); }
+    topKeyStart = now;
+}
+
+json_stats::Stats JSON_File::stats(){
+    json_stats::Stats snapshot = counters;
+    snapshot.bytes = out.file().bytes();
+    snapshot.flushes = out.file().flushes();
+    snapshot.ioNanoseconds = out.file().io_nanoseconds();
+
+    //the key we're in the middle of gets everything so far
+    if(initialized && !snapshot.topLevelBytes.empty()){ snapshot.topLevelBytes.back().second = snapshot.bytes - topKeyStart; }
+
+    return snapshot;
+}
+
+bool JSON_File::dump_stats(string filename){
+    JSON_File side;
+    if(!side.open(filename) || !side.isInitialized()){
+        counters.failedDumps++;
+        return false;
+    }
+
+    json_stats::Stats s = stats();
+    side.print_element("bytes", (long long)s.bytes)
+        .print_element("flushes", (long long)s.flushes)
+        .print_element("io seconds", s.ioNanoseconds / 1e9)
+        .print_element("max depth", s.maxDepth)
+        .print_element("failed dumps", (long long)s.failedDumps);
+    side.open_object("tokens")
+        .print_element("total", (long long)s.tokens())
+        .print_element("objects", (long long)s.objects)
+        .print_element("arrays", (long long)s.arrays)
+        .print_element("sub arrays", (long long)s.subArrays)
+        .print_element("strings", (long long)s.strings)
+        .print_element("ints", (long long)s.ints)
+        .print_element("doubles", (long long)s.doubles)
+        .print_element("bools", (long long)s.bools)
+        .print_element("nulls", (long long)s.nulls)
+        .print_element("binaries", (long long)s.binaries)
+        .close_object();
+    side.open_array("top level bytes");
+    for(int i=0;i<s.topLevelBytes.size();i++){
+        side.open_sub_array();
+        side.print_data(vector<string>(1, s.topLevelBytes[i].first));
+        side.print_data(vector<long long>(1, s.topLevelBytes[i].second));
+        side.close_sub_array();
+    }
+    side.close();
+
+    return true;
+}
+
+void JSON_File::dump_stats_every(string filename, double seconds){
+    statsFile = filename;
+    statsInterval = seconds;
+    stat_schedule_dump();
+}
+
+//Called by the filebuf after each real write, so the clock is only read once per buffer
+void JSON_File::stat_on_flush(void* self){
+    JSON_File* json = static_cast<JSON_File*>(self);
+    if(json->statsFile.empty() || !json->initialized){ return; }
+
+    if(json_stats::clock::now() >= json->nextDump){
+        json->stat_schedule_dump();
+        json->dump_stats(json->statsFile);
+    }
+}
+#endif
+
+/**
+ * Implementations of JSON_Columns
+ */
+template <class... Ts>
+JSON_Columns<Ts...>::JSON_Columns(JSON_File& file, string name, vector<string> columnNames, size_t rowsPerBatch)
+        : json(file), names(columnNames), batchSize(rowsPerBatch == 0 ? 1 : rowsPerBatch), rows(0), opened(false) {
+    if(names.size() != sizeof...(Ts)){
+        throw new JSON_File::COLUMN_COUNT_ERROR("JSON_Columns NEEDS ONE NAME PER COLUMN TYPE");
+    }
+    set<string> seen;
+    for(int i=0;i<names.size();i++){
+        if(!seen.insert(names[i]).second){
+            throw new JSON_File::DUPLICATE_KEY_ERROR("DUPLICATE COLUMN NAME \"" + names[i] + "\" IN JSON_Columns");
+        }
+    }
+
+    add_printers<0>();
+    if(json.sortLimit > 0){//same key order as the rest of a sorted file
+        vector<pair<string, int> > byName;
+        for(int i=0;i<names.size();i++){ byName.push_back(make_pair(names[i], i)); }
+        sort(byName.begin(), byName.end());
+
+        vector<Printer> unsorted(printers);
+        for(int i=0;i<byName.size();i++){ printers[i] = unsorted[byName[i].second]; }
+    }
+
+    json.open_array(name);
+    opened = true;
+}
+
+template <class... Ts>
+JSON_Columns<Ts...>& JSON_Columns<Ts...>::add(const Ts&... vals){
+    if(!opened){ throw new JSON_File::NOT_INITIALIZED_ERROR("CALLED JSON_Columns::add() AFTER close()"); }
+
+    push<0>(vals...);
+    if(++rows >= batchSize){ flush(); }
+
+    return *this;//chaining
+}
+
+template <class... Ts>
+void JSON_Columns<Ts...>::flush(){
+    if(!opened){ throw new JSON_File::NOT_INITIALIZED_ERROR("CALLED JSON_Columns::flush() AFTER close()"); }
+    if(rows == 0){ return; }
+
+    //{"cols": [...], "data": {...}} as an element of the array, indented like open_object would
+    string depth(json.currDepth, ' ');
+    if(json.comma) json.out << ",\n";
+    json.out << depth << "{\n";
+    enter('}');
+
+    string inner(json.currDepth, ' ');
+    json.out << inner << "\"cols\": [";
+    for(int i=0;i<names.size();i++){
+        if(i != 0) json.out << ", ";
+        json.print_name(names[i]);
+    }
+    json.out << "],\n" << inner << "\"data\": {\n";
+    enter('}');
+
+    string colDepth(json.currDepth, ' ');
+    for(int i=0;i<printers.size();i++){
+        if(i != 0) json.out << ",\n";
+        enter(']');
+        (this->*printers[i])(colDepth);
+        leave();
+    }
+
+    leave();
+    json.out << '\n' << inner << "}";
+    leave();
+    json.out << '\n' << depth << "}";
+    json.comma = true;
+    JSON_FILE_STAT(json.counters.objects += 2; json.counters.arrays += 1 + sizeof...(Ts);)
+
+    rows = 0;
+}
+//The same bracket/depth bookkeeping open_object/open_array and the closes do, for the batch's containers
+template <class... Ts>
+void JSON_Columns<Ts...>::enter(char bracket){
+    json.brackets.push(bracket);
+    if(bracket == '}') json.currDepth += 2;
+    JSON_FILE_STAT(json.stat_depth();)
+}
+template <class... Ts>
+void JSON_Columns<Ts...>::leave(){
+    if(json.brackets.top() == '}') json.currDepth -= 2;
+    json.brackets.pop();
+}
+template <class... Ts>
+template <size_t I>
+void JSON_Columns<Ts...>::print_column(const string& depth){
+    json.out << depth;
+    json.print_name(names[I]);
+    json.out << ": [";
+
+    json.comma = false;
+    json.print_data(get<I>(columns), false);
+    json.out << "]";
+    get<I>(columns).clear();//keeps its capacity for the next batch
+}
+
+template <class... Ts>
+void JSON_Columns<Ts...>::close(){
+    if(opened){
+        flush();
+        opened = false;
+        json.close_array();
+    }
+}
+
+#endif
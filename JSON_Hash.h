@@ -0,0 +1,206 @@
+/**
+ * Author: Ethan Dickey
+ *
+ * Streaming content hash for JSON_File.  json_hash::filebuf is the std::filebuf JSON_File
+ * writes through; with hashing turned on it runs XXH64 (seed 0, same result as
+ * "xxhsum -H64 file") over the bytes as they leave the buffer, so the hash of the whole file
+ * is ready when it's closed without reading anything back.
+ */
+#ifndef JSON_HASH_H
+#define JSON_HASH_H
+
+#include <cstring>
+#include <fstream>
+#include <ostream>
+
+namespace json_hash {
+
+/**
+ * XXH64, fed in pieces (update) and read at the end (digest)
+ */
+class xxh64 {
+private:
+    static const unsigned long long P1 = 11400714785074694791ULL, P2 = 14029467366897019727ULL,
+                                    P3 = 1609587929392839161ULL,  P4 = 9650029242287828579ULL,
+                                    P5 = 2870177450012600261ULL;
+
+    unsigned long long v1, v2, v3, v4, total, seed;
+    unsigned char buffer[32];//partial stripe
+    size_t buffered;
+
+    static unsigned long long rotl(unsigned long long x, int r){ return (x << r) | (x >> (64 - r)); }
+    static unsigned long long read64(const unsigned char* p){ unsigned long long v; memcpy(&v, p, 8); return v; }//little endian
+    static unsigned long long read32(const unsigned char* p){ unsigned int v; memcpy(&v, p, 4); return v; }
+    static unsigned long long round(unsigned long long acc, unsigned long long input){ return rotl(acc + input * P2, 31) * P1; }
+    static unsigned long long merge(unsigned long long acc, unsigned long long val){ return (acc ^ round(0, val)) * P1 + P4; }
+
+    void stripe(const unsigned char* p){
+        v1 = round(v1, read64(p));
+        v2 = round(v2, read64(p + 8));
+        v3 = round(v3, read64(p + 16));
+        v4 = round(v4, read64(p + 24));
+    }
+
+public:
+    xxh64(unsigned long long s = 0){ reset(s); }
+
+    void reset(unsigned long long s = 0){
+        seed = s;
+        v1 = s + P1 + P2;
+        v2 = s + P2;
+        v3 = s;
+        v4 = s - P1;
+        total = 0;
+        buffered = 0;
+    }
+
+    void update(const void* data, size_t len){
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        const unsigned char* end = p + len;
+        total += len;
+
+        //finish the partial stripe first
+        if(buffered + len < 32){
+            memcpy(buffer + buffered, p, len);
+            buffered += len;
+            return;
+        }
+        if(buffered){
+            memcpy(buffer + buffered, p, 32 - buffered);
+            p += 32 - buffered;
+            stripe(buffer);
+            buffered = 0;
+        }
+
+        for(; p + 32 <= end; p += 32){ stripe(p); }
+
+        buffered = end - p;
+        memcpy(buffer, p, buffered);
+    }
+
+    unsigned long long digest() const {
+        unsigned long long h;
+        if(total >= 32){
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = merge(h, v1);
+            h = merge(h, v2);
+            h = merge(h, v3);
+            h = merge(h, v4);
+        } else {
+            h = seed + P5;
+        }
+        h += total;
+
+        const unsigned char* p = buffer;
+        const unsigned char* end = buffer + buffered;
+        for(; p + 8 <= end; p += 8){ h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4; }
+        if(p + 4 <= end){ h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3; p += 4; }
+        for(; p < end; p++){ h = rotl(h ^ (*p * P5), 11) * P1; }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+};
+
+/**
+ * A std::filebuf that can hash what it writes.  Bytes are hashed just before the buffer
+ * hands them to the OS (everything up to `hashed` in the put area has been hashed already),
+ * which is exactly the order they end up in the file.
+ */
+class filebuf : public std::filebuf {
+private:
+    xxh64 hasher;
+    bool hashing;
+    const char* hashed;//put area bytes before this are already in the hash
+    bool busy;//filebuf::xsputn may call our overflow() -- only hash in the outer call
+
+    //hash what was added to the buffer since last time (and what's about to be added)
+    void catch_up(const char* incoming, std::streamsize n){
+        if(hashed < this->pbase() || hashed > this->pptr()) hashed = this->pbase();
+        if(this->pptr() > hashed) hasher.update(hashed, this->pptr() - hashed);
+        if(n > 0) hasher.update(incoming, n);
+    }
+
+protected:
+    int_type overflow(int_type c){
+        if(!hashing || busy) return std::filebuf::overflow(c);
+
+        char ch = traits_type::to_char_type(c);
+        catch_up(&ch, traits_type::eq_int_type(c, traits_type::eof()) ? 0 : 1);
+        busy = true;
+        int_type result = std::filebuf::overflow(c);
+        busy = false;
+        hashed = this->pptr();
+        return result;
+    }
+    int sync(){
+        if(!hashing || busy) return std::filebuf::sync();
+
+        catch_up(0, 0);
+        busy = true;
+        int result = std::filebuf::sync();
+        busy = false;
+        hashed = this->pptr();
+        return result;
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n){
+        //fits in the buffer: just a copy (cheaper than filebuf::xsputn), hashed when it leaves
+        if(n < this->epptr() - this->pptr()){
+            traits_type::copy(this->pptr(), s, n);
+            this->pbump(n);
+            return n;
+        }
+        if(!hashing || busy) return std::filebuf::xsputn(s, n);
+
+        catch_up(s, n);
+        busy = true;
+        std::streamsize result = std::filebuf::xsputn(s, n);
+        busy = false;
+        hashed = this->pptr();
+        return result;
+    }
+
+public:
+    filebuf(): hashing(false), hashed(0), busy(false) {}
+
+    //Turn hashing on/off for the next file (call before open)
+    void set_hashing(bool on){ hashing = on; }
+    bool is_hashing() const { return hashing; }
+    //Start over for a new file (basic_ofstream::open calls this; derived buffers add their own state)
+    void reset(){ hasher.reset(); hashed = this->pptr(); }
+    //Only complete once everything has been flushed (i.e. after close)
+    unsigned long long hash() const { return hasher.digest(); }
+};
+
+/**
+ * Just enough of std::ofstream (open/is_open/close) for JSON_File to swap it in, writing
+ * through Buf (json_hash::filebuf or something derived from it)
+ */
+template <class Buf>
+class basic_ofstream : public std::ostream {
+private:
+    Buf buf;
+
+public:
+    basic_ofstream(): std::ostream(&buf) {}
+
+    void open(const char* filename){
+        buf.reset();
+        if(buf.open(filename, std::ios_base::out | std::ios_base::trunc)) this->clear();
+        else this->setstate(std::ios_base::failbit);
+    }
+    bool is_open() const { return buf.is_open(); }
+    void close(){ if(!buf.close()) this->setstate(std::ios_base::failbit); }
+
+    Buf& file(){ return buf; }
+};
+
+typedef basic_ofstream<filebuf> ofstream;
+
+}//namespace json_hash
+
+#endif
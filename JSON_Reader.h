@@ -0,0 +1,660 @@
+/**
+ * Author: Ethan Dickey
+ *
+ * On-demand reader for pulling a few values out of big JSON files (e.g. ones JSON_File wrote)
+ * without parsing the whole thing.  The file is mmap'd and walked once, front to back: only the
+ * objects/arrays on the way to the requested paths are looked at key by key, everything else
+ * is skipped by bracket matching over a structural scan (64 bytes at a time, SSE2/AVX2 when
+ * available, like Base64.h).  Nothing is decoded until it's asked for: values are views into
+ * the mapping, numbers are parsed by as_double()/as_long() and strings unescaped by str().
+ *
+ *     JSON_Reader reader("secondFile.out");//".json" is appended like JSON_File::open()
+ *     JSON_Value v = reader.find("/myObject/my ints?/2");
+ *     vector<JSON_Value> vs = reader.find({"/a/b", "/a/c/0", "/d"});//one pass for all of them
+ *
+ * Paths are JSON Pointers (RFC 6901): "/" separated keys or array indices, "~1" for a '/' in a
+ * key and "~0" for a '~'; "" is the whole file.  If a key appears twice the first one wins.
+ * JSON_Values point into the mapping and are only valid until the reader is closed.
+ *
+ * POSIX only (mmap).
+ */
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <exception>
+#include <initializer_list>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if __cplusplus >= 201703L
+    #include <string_view>
+#endif
+#include "Base64.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+namespace json_scan {
+
+static const size_t NO_MATCH = (size_t)-1;
+
+//Where the interesting characters are in a 64 byte block (bit i = byte i)
+struct Block {
+    unsigned long long quote, backslash, open, close;//open = '{' or '[', close = '}' or ']'
+};
+
+inline void classify(const char* p, Block& b){
+#if defined(__AVX2__)
+    const __m256i quote = _mm256_set1_epi8('"'), backslash = _mm256_set1_epi8('\\'),
+                  open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}'), lower = _mm256_set1_epi8(0x20);
+    b.quote = b.backslash = b.open = b.close = 0;
+    for(int i=0;i<64;i+=32){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i folded = _mm256_or_si256(v, lower);//'[' | 0x20 == '{', ']' | 0x20 == '}'
+        b.quote     |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << i;
+        b.backslash |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)) << i;
+        b.open      |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, open)) << i;
+        b.close     |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(folded, close)) << i;
+    }
+#elif defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'),
+                  open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}'), lower = _mm_set1_epi8(0x20);
+    b.quote = b.backslash = b.open = b.close = 0;
+    for(int i=0;i<64;i+=16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i folded = _mm_or_si128(v, lower);
+        b.quote     |= (unsigned long long)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << i;
+        b.backslash |= (unsigned long long)_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)) << i;
+        b.open      |= (unsigned long long)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, open)) << i;
+        b.close     |= (unsigned long long)_mm_movemask_epi8(_mm_cmpeq_epi8(folded, close)) << i;
+    }
+#else
+    b.quote = b.backslash = b.open = b.close = 0;
+    for(int i=0;i<64;i++){
+        char folded = p[i] | 0x20;
+        if(p[i] == '"')       b.quote |= 1ULL << i;
+        else if(p[i] == '\\') b.backslash |= 1ULL << i;
+        else if(folded == '{') b.open |= 1ULL << i;
+        else if(folded == '}') b.close |= 1ULL << i;
+    }
+#endif
+}
+
+//Bit i = xor of bits 0..i (turns quote positions into "inside a string" ranges)
+inline unsigned long long prefix_xor(unsigned long long x){
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+//Characters escaped by a backslash (odd length runs of backslashes), carrying over between
+//blocks through prevEscaped (same trick as simdjson)
+inline unsigned long long find_escaped(unsigned long long backslash, unsigned long long& prevEscaped){
+    const unsigned long long even = 0x5555555555555555ULL;
+
+    backslash &= ~prevEscaped;
+    unsigned long long followsEscape = (backslash << 1) | prevEscaped;
+    unsigned long long oddStarts = backslash & ~even & ~followsEscape;
+    unsigned long long sequencesOnEven = oddStarts + backslash;
+    prevEscaped = (sequencesOnEven < oddStarts ? 1 : 0);//carry out of the block
+    unsigned long long invert = sequencesOnEven << 1;
+    return (even ^ invert) & followsEscape;
+}
+
+/**
+ * Description: finds the bracket that brings depth to 0, starting outside of any string
+ *
+ * @param  data  : text
+ * @param  pos   : where to start (just after an opening bracket for depth 1)
+ * @param  len   : length of data
+ * @param  depth : how many brackets are open at pos
+ * @return size_t : position just after the matching bracket, or NO_MATCH if there isn't one
+ */
+inline size_t match(const char* data, size_t pos, size_t len, int depth){
+    unsigned long long prevEscaped = 0, prevInString = 0;
+    char tail[64];
+    Block b;
+
+    for(; pos < len; pos += 64){
+        const char* p = data + pos;
+        if(len - pos < 64){//last partial block, padded with spaces (never reads past the mapping)
+            memset(tail, ' ', 64);
+            memcpy(tail, p, len - pos);
+            p = tail;
+        }
+        classify(p, b);
+
+        unsigned long long quotes = b.quote & ~find_escaped(b.backslash, prevEscaped);
+        unsigned long long inString = prefix_xor(quotes) ^ prevInString;
+        prevInString = (unsigned long long)((long long)inString >> 63);
+
+        unsigned long long open = b.open & ~inString, close = b.close & ~inString;
+        int closes = __builtin_popcountll(close);
+        if(closes < depth){//can't get back to 0 in this block
+            depth += __builtin_popcountll(open) - closes;
+            continue;
+        }
+
+        for(unsigned long long brackets = open | close; brackets; brackets &= brackets - 1){
+            unsigned long long bit = brackets & (0 - brackets);
+            if(open & bit){
+                depth++;
+            } else if(--depth == 0){
+                return pos + __builtin_ctzll(bit) + 1;
+            }
+        }
+    }
+
+    return NO_MATCH;
+}
+
+}//namespace json_scan
+
+/**
+ * A value found by JSON_Reader: where it is in the file, decoded on request
+ */
+class JSON_Value {
+public:
+    enum TYPES { MISSING, OBJECT, ARRAY, STRING, NUMBER, BOOLEAN, NULL_VALUE };
+
+    struct TYPE_ERROR : public std::exception {
+        std::string message;
+
+        TYPE_ERROR(std::string m): message(m) {}
+        const char* what() const throw(){ return message.c_str(); }//for c++
+    };
+
+private:
+    const char* text;//strings: just inside the quotes
+    size_t length;
+    TYPES kind;
+    bool escaped;//string has a backslash in it
+
+    void expect(TYPES t, const char* function) const;
+    const char* copy_number(char* buffer, size_t size, std::string& longer, const char* function) const;
+
+public:
+    JSON_Value(): text(0), length(0), kind(MISSING), escaped(false) {}
+    JSON_Value(const char* begin, const char* end);
+
+    TYPES type() const { return kind; }
+    bool exists() const { return kind != MISSING; }
+    bool is_null() const { return kind == NULL_VALUE; }
+
+    //Raw text as it is in the file (strings without their quotes, still escaped)
+    const char* data() const { return text; }
+    size_t size() const { return length; }
+#if __cplusplus >= 201703L
+    std::string_view view() const { return std::string_view(text, length); }
+#endif
+
+    /**
+     * Description: the value as a string: strings are unescaped, anything else is its raw text
+     *
+     * @return std::string : the value
+     */
+    std::string str() const;
+    double as_double() const;
+    long long as_long() const;
+    bool as_bool() const;
+    /**
+     * Description: decodes a string written by JSON_File::print_binary
+     *
+     * @param  out  : decoded bytes are appended here
+     * @return bool : false if it isn't valid base64
+     */
+    bool binary(std::vector<unsigned char>& out) const;
+};
+
+class JSON_Reader {
+private:
+    int fd;
+    const char* text;//the mapping
+    size_t length;
+
+    //Requested paths, merged into a tree so one pass answers all of them
+    struct PathNode {
+        std::string token;
+        std::vector<int> children;//indices into nodes
+        std::vector<int> results;//which requests end here
+        bool found;//first matching key wins
+    };
+    std::vector<PathNode> nodes;
+    std::vector<JSON_Value>* results;
+
+    JSON_Reader(const JSON_Reader&);//the mapping isn't shared
+    JSON_Reader& operator=(const JSON_Reader&);
+
+    void add_path(const std::string& path, int request);
+    size_t walk(int node, size_t pos);
+    size_t walk_object(int node, size_t pos);
+    size_t walk_array(int node, size_t pos);
+    size_t skip_value(size_t pos);
+    size_t skip_string(size_t pos);//pos = just after the opening quote, returns the closing quote's position
+    size_t whitespace(size_t pos){
+        while(pos < length && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\t' || text[pos] == '\r')) pos++;
+        return pos;
+    }
+    bool key_equals(size_t begin, size_t end, bool escaped, const std::string& key);
+    void malformed(size_t pos, const char* expected);
+
+public:
+    struct READER_ERROR : public std::exception {
+        std::string message;
+
+        READER_ERROR(std::string m): message(m) {}
+        const char* what() const throw(){ return message.c_str(); }//for c++
+    };
+
+    JSON_Reader(): fd(-1), text(0), length(0), results(0) {}
+    JSON_Reader(std::string filename): fd(-1), text(0), length(0), results(0) { this->open(filename); }
+    ~JSON_Reader(){
+        if(isInitialized()){
+            this->close();
+        }
+    }
+
+    /**
+     * Description: maps filename (plus ".json" if it doesn't end in it already) for reading
+     *
+     * @param  filename : the file name
+     * @return void
+     */
+    void open(std::string filename);
+    void close();
+    bool isInitialized(){ return text != 0; }
+    size_t size(){ return length; }
+
+    /**
+     * Description: looks up one path (see the top of the file for the syntax)
+     *
+     * @param  path : JSON Pointer, e.g. "/myObject/my ints?/2"
+     * @return JSON_Value : the value (type() == MISSING if it isn't there)
+     */
+    JSON_Value find(const std::string& path);
+    /**
+     * Description: looks up several paths in one pass over the file
+     *
+     * @param  paths : JSON Pointers
+     * @return std::vector<JSON_Value> : one value per path, in the same order
+     */
+    std::vector<JSON_Value> find(const std::vector<std::string>& paths);
+    std::vector<JSON_Value> find(std::initializer_list<std::string> paths){ return find(std::vector<std::string>(paths)); }
+};
+
+
+/**
+ * Implementations of JSON_Value
+ */
+JSON_Value::JSON_Value(const char* begin, const char* end): text(begin), length(end - begin), escaped(false) {
+    switch(*begin){
+        case '{': kind = OBJECT; break;
+        case '[': kind = ARRAY; break;
+        case '"':
+            kind = STRING;
+            text++;
+            length -= 2;
+            escaped = (memchr(text, '\\', length) != 0);
+            break;
+        case 't': case 'f': kind = BOOLEAN; break;
+        default:
+            //anything else is a number (JSON_File writes inf/nan as they are, strtod reads them back)
+            kind = (length == 4 && memcmp(begin, "null", 4) == 0 ? NULL_VALUE : NUMBER);
+            break;
+    }
+}
+
+void JSON_Value::expect(TYPES t, const char* function) const {
+    static const char* names[] = {"missing", "object", "array", "string", "number", "boolean", "null"};
+    if(kind != t){
+        throw new TYPE_ERROR(std::string("CALLED JSON_Value::") + function + "() ON A " + names[kind] + " VALUE");
+    }
+}
+
+//numbers aren't null terminated in the mapping: copied to buffer, or to longer if they don't fit
+const char* JSON_Value::copy_number(char* buffer, size_t size, std::string& longer, const char* function) const {
+    expect(NUMBER, function);
+    if(length >= size){
+        longer.assign(text, length);
+        return longer.c_str();
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return buffer;
+}
+
+std::string JSON_Value::str() const {
+    if(kind != STRING || !escaped) return std::string(text, length);
+
+    std::string out;
+    out.reserve(length);
+    for(size_t i=0;i<length;i++){
+        if(text[i] != '\\' || i + 1 >= length){ out += text[i]; continue; }
+
+        char c = text[++i];
+        switch(c){
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                if(i + 4 >= length){ out += c; break; }
+                unsigned long code = strtoul(std::string(text + i + 1, 4).c_str(), 0, 16);
+                i += 4;
+                //surrogate pair
+                if(code >= 0xd800 && code < 0xdc00 && i + 6 < length && text[i+1] == '\\' && text[i+2] == 'u'){
+                    unsigned long low = strtoul(std::string(text + i + 3, 4).c_str(), 0, 16);
+                    if(low >= 0xdc00 && low < 0xe000){
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                        i += 6;
+                    }
+                }
+                //UTF-8
+                if(code < 0x80){
+                    out += (char)code;
+                } else if(code < 0x800){
+                    out += (char)(0xc0 | (code >> 6));
+                    out += (char)(0x80 | (code & 0x3f));
+                } else if(code < 0x10000){
+                    out += (char)(0xe0 | (code >> 12));
+                    out += (char)(0x80 | ((code >> 6) & 0x3f));
+                    out += (char)(0x80 | (code & 0x3f));
+                } else {
+                    out += (char)(0xf0 | (code >> 18));
+                    out += (char)(0x80 | ((code >> 12) & 0x3f));
+                    out += (char)(0x80 | ((code >> 6) & 0x3f));
+                    out += (char)(0x80 | (code & 0x3f));
+                }
+                break;
+            }
+            default: out += c; break;//\" \\ \/
+        }
+    }
+    return out;
+}
+
+double JSON_Value::as_double() const {
+    char buffer[64];
+    std::string longer;
+    return strtod(copy_number(buffer, sizeof(buffer), longer, "as_double"), 0);
+}
+
+long long JSON_Value::as_long() const {
+    char buffer[64];
+    std::string longer;
+    const char* number = copy_number(buffer, sizeof(buffer), longer, "as_long");
+    if(strcspn(number, ".eEin") != length) return (long long)strtod(number, 0);//1e3, 2.0
+    return strtoll(number, 0, 10);
+}
+
+bool JSON_Value::as_bool() const {
+    expect(BOOLEAN, "as_bool");
+    return *text == 't';
+}
+
+bool JSON_Value::binary(std::vector<unsigned char>& out) const {
+    expect(STRING, "binary");
+    return base64::decode(text, length, out);
+}
+
+
+/**
+ * Implementations of JSON_Reader
+ */
+void JSON_Reader::open(std::string filename){
+    if(isInitialized()){ throw new READER_ERROR("CALLED JSON_Reader::open() WHILE A FILE IS OPEN"); }
+
+    //Append .json to the end of the file (unless it's already there, like JSON_File::open())
+    if(filename.length() < 5 || filename.substr(filename.length()-5, 5) != ".json"){
+        filename += ".json";
+    }
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0){ throw new READER_ERROR("JSON_Reader::open() COULDN'T OPEN " + filename); }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0 || info.st_size == 0){
+        ::close(fd);
+        fd = -1;
+        throw new READER_ERROR("JSON_Reader::open() " + filename + " IS EMPTY OR UNREADABLE");
+    }
+
+    length = info.st_size;
+    void* mapping = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(mapping == MAP_FAILED){
+        ::close(fd);
+        fd = -1;
+        length = 0;
+        throw new READER_ERROR("JSON_Reader::open() COULDN'T MAP " + filename);
+    }
+    madvise(mapping, length, MADV_SEQUENTIAL);//one pass, front to back
+
+    text = static_cast<const char*>(mapping);
+}
+
+void JSON_Reader::close(){
+    if(!isInitialized()){ throw new READER_ERROR("CALLED JSON_Reader::close() WITHOUT INITIALIZING"); }
+
+    munmap((void*)text, length);
+    ::close(fd);
+    text = 0;
+    length = 0;
+    fd = -1;
+}
+
+JSON_Value JSON_Reader::find(const std::string& path){
+    return find(std::vector<std::string>(1, path))[0];
+}
+
+std::vector<JSON_Value> JSON_Reader::find(const std::vector<std::string>& paths){
+    if(!isInitialized()){ throw new READER_ERROR("CALLED JSON_Reader::find() WITHOUT INITIALIZING"); }
+
+    std::vector<JSON_Value> found(paths.size());
+
+    nodes.assign(1, PathNode());
+    nodes[0].found = false;
+    for(int i=0;i<paths.size();i++){ add_path(paths[i], i); }
+
+    results = &found;
+    walk(0, 0);
+    results = 0;
+
+    return found;
+}
+
+//Splits a JSON Pointer into tokens and adds them to the tree
+void JSON_Reader::add_path(const std::string& path, int request){
+    if(!path.empty() && path[0] != '/'){ throw new READER_ERROR("JSON_Reader::find() PATH \"" + path + "\" DOESN'T START WITH '/'"); }
+
+    int node = 0;
+    size_t start = 1;
+    while(start <= path.size() && !path.empty()){
+        size_t slash = path.find('/', start);
+        if(slash == std::string::npos) slash = path.size();
+
+        std::string token;
+        for(size_t i=start;i<slash;i++){
+            if(path[i] == '~' && i + 1 < slash && (path[i+1] == '0' || path[i+1] == '1')){
+                token += (path[++i] == '0' ? '~' : '/');
+            } else {
+                token += path[i];
+            }
+        }
+
+        int child = -1;
+        for(int i=0;i<nodes[node].children.size();i++){
+            if(nodes[nodes[node].children[i]].token == token){ child = nodes[node].children[i]; break; }
+        }
+        if(child == -1){
+            child = nodes.size();
+            nodes.push_back(PathNode());
+            nodes[child].token = token;
+            nodes[child].found = false;
+            nodes[node].children.push_back(child);
+        }
+
+        node = child;
+        start = slash + 1;
+    }
+
+    nodes[node].results.push_back(request);
+}
+
+//Reads the value at pos for node (and whatever's wanted inside it), returns the position after it
+size_t JSON_Reader::walk(int node, size_t pos){
+    pos = whitespace(pos);
+    if(pos >= length) malformed(pos, "a value");
+
+    size_t end;
+    if(nodes[node].children.empty()) end = skip_value(pos);
+    else if(text[pos] == '{') end = walk_object(node, pos);
+    else if(text[pos] == '[') end = walk_array(node, pos);
+    else end = skip_value(pos);//nothing inside a string/number
+
+    for(int i=0;i<nodes[node].results.size();i++){
+        (*results)[nodes[node].results[i]] = JSON_Value(text + pos, text + end);
+    }
+    nodes[node].found = true;
+
+    return end;
+}
+
+size_t JSON_Reader::walk_object(int node, size_t pos){
+    size_t remaining = nodes[node].children.size();
+
+    pos = whitespace(pos + 1);
+    if(pos < length && text[pos] == '}') return pos + 1;
+
+    while(true){
+        //"key"
+        if(pos >= length || text[pos] != '"') malformed(pos, "a key");
+        size_t keyBegin = pos + 1, keyEnd = skip_string(keyBegin);
+        pos = whitespace(keyEnd + 1);
+        if(pos >= length || text[pos] != ':') malformed(pos, "':'");
+        pos++;
+
+        int child = -1;
+        bool escaped = (memchr(text + keyBegin, '\\', keyEnd - keyBegin) != 0);
+        for(int i=0;i<nodes[node].children.size();i++){
+            int c = nodes[node].children[i];
+            if(!nodes[c].found && key_equals(keyBegin, keyEnd, escaped, nodes[c].token)){ child = c; break; }
+        }
+
+        if(child != -1){
+            pos = walk(child, pos);
+            //got everything we wanted from this object: jump to its end
+            if(--remaining == 0){
+                pos = json_scan::match(text, pos, length, 1);
+                if(pos == json_scan::NO_MATCH) malformed(length, "'}'");
+                return pos;
+            }
+        } else {
+            pos = skip_value(whitespace(pos));
+        }
+
+        pos = whitespace(pos);
+        if(pos < length && text[pos] == ',') pos = whitespace(pos + 1);
+        else if(pos < length && text[pos] == '}') return pos + 1;
+        else malformed(pos, "',' or '}'");
+    }
+}
+
+size_t JSON_Reader::walk_array(int node, size_t pos){
+    size_t remaining = 0;
+    for(int i=0;i<nodes[node].children.size();i++){
+        const std::string& token = nodes[nodes[node].children[i]].token;
+        if(!token.empty() && token.find_first_not_of("0123456789") == std::string::npos) remaining++;
+    }
+
+    pos = whitespace(pos + 1);
+    if(pos < length && text[pos] == ']') return pos + 1;
+
+    for(size_t index=0;;index++){
+        int child = -1;
+        if(remaining > 0){
+            std::string token = std::to_string(index);
+            for(int i=0;i<nodes[node].children.size();i++){
+                if(nodes[nodes[node].children[i]].token == token){ child = nodes[node].children[i]; break; }
+            }
+        }
+
+        if(child != -1){
+            pos = walk(child, pos);
+            if(--remaining == 0){
+                pos = json_scan::match(text, pos, length, 1);
+                if(pos == json_scan::NO_MATCH) malformed(length, "']'");
+                return pos;
+            }
+        } else {
+            pos = skip_value(whitespace(pos));
+        }
+
+        pos = whitespace(pos);
+        if(pos < length && text[pos] == ',') pos = whitespace(pos + 1);
+        else if(pos < length && text[pos] == ']') return pos + 1;
+        else malformed(pos, "',' or ']'");
+    }
+}
+
+size_t JSON_Reader::skip_value(size_t pos){
+    if(pos >= length) malformed(pos, "a value");
+
+    switch(text[pos]){
+        case '{': case '[': {
+            size_t end = json_scan::match(text, pos + 1, length, 1);
+            if(end == json_scan::NO_MATCH) malformed(length, "a closing bracket");
+            return end;
+        }
+        case '"':
+            return skip_string(pos + 1) + 1;
+        default: {
+            //number/true/false/null: up to the next delimiter
+            size_t end = pos;
+            while(end < length && text[end] != ',' && text[end] != '}' && text[end] != ']' &&
+                  text[end] != ' ' && text[end] != '\n' && text[end] != '\t' && text[end] != '\r') end++;
+            if(end == pos) malformed(pos, "a value");
+            return end;
+        }
+    }
+}
+
+size_t JSON_Reader::skip_string(size_t pos){
+    while(true){
+        const char* quote = static_cast<const char*>(memchr(text + pos, '"', length - pos));
+        if(quote == 0) malformed(length, "'\"'");
+
+        //escaped if there's an odd number of backslashes in front of it
+        size_t q = quote - text, backslashes = 0;
+        while(q - backslashes > pos && text[q - backslashes - 1] == '\\') backslashes++;
+        if(backslashes % 2 == 0) return q;
+        pos = q + 1;
+    }
+}
+
+bool JSON_Reader::key_equals(size_t begin, size_t end, bool escaped, const std::string& key){
+    if(!escaped){
+        return end - begin == key.size() && memcmp(text + begin, key.data(), key.size()) == 0;
+    }
+
+    //escaped key: compare what it decodes to
+    std::string quoted(text + begin - 1, end - begin + 2);
+    return JSON_Value(quoted.data(), quoted.data() + quoted.size()).str() == key;
+}
+
+void JSON_Reader::malformed(size_t pos, const char* expected){
+    throw new READER_ERROR("JSON_Reader::find() EXPECTED " + std::string(expected) + " AT BYTE " + std::to_string(pos));
+}
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * Author: Ethan Dickey
+ *
+ * Delta snapshots of state that gets dumped over and over.  Every snapshot is written with
+ * the same calls (open_object/close_object/print_element/print_array between begin() and
+ * end()), but only snapshot 0, N, 2N, ... are written in full ("keyframes").  The others only
+ * contain what changed since the previous snapshot, as a JSON Merge Patch (RFC 7386):
+ * changed and added keys with their new values, removed keys as null, and unchanged keys
+ * left out.  Arrays are treated as single values (a changed array is written whole).
+ *
+ * Files are <base>.<k>.full.json and <base>.<k>.delta.json.  To get snapshot k back, start
+ * from the last keyframe at or before k and apply the deltas after it in order:
+ *
+ *     python3 reconstructSnapshot.py <base> <k>
+ *
+ * Between snapshots only the keys (in a tree of maps shaped like the state) and a 64 bit hash
+ * of each value are kept, not the values themselves.  A key can only be written once per
+ * snapshot (a second write throws SNAPSHOT_ERROR).
+ */
+#ifndef JSON_SNAPSHOTS_H
+#define JSON_SNAPSHOTS_H
+
+#include "JSON_File.h"
+#include <map>
+#include <memory>
+#include <exception>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+
+namespace json_snapshot_hash {
+
+//FNV-1a, with a type tag first so 1, 1.0, true and "1" all hash differently
+inline void bytes(unsigned long long& h, const void* data, size_t len){
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for(size_t i=0;i<len;i++){
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+}
+inline void tag(unsigned long long& h, char t){ bytes(h, &t, 1); }
+
+inline void value(unsigned long long& h, const string& val){ tag(h, 's'); size_t n = val.size(); bytes(h, &n, sizeof(n)); bytes(h, val.data(), n); }
+inline void value(unsigned long long& h, const char* val){ value(h, string(val)); }
+inline void value(unsigned long long& h, bool val){ tag(h, 'b'); bytes(h, &val, sizeof(val)); }
+inline void value(unsigned long long& h, int val){ long long v = val; tag(h, 'i'); bytes(h, &v, sizeof(v)); }
+inline void value(unsigned long long& h, long long val){ tag(h, 'i'); bytes(h, &val, sizeof(val)); }
+inline void value(unsigned long long& h, double val){ tag(h, 'd'); bytes(h, &val, sizeof(val)); }
+
+//Arrays of plain numbers are hashed as one block of memory
+template <class T>
+typename enable_if<is_arithmetic<T>::value && !is_same<T, bool>::value>::type value(unsigned long long& h, const vector<T>& vals){
+    tag(h, '[');
+    size_t n = vals.size();
+    bytes(h, &n, sizeof(n));
+    if(n) bytes(h, vals.data(), n * sizeof(T));
+}
+template <class T>
+typename enable_if<!is_arithmetic<T>::value || is_same<T, bool>::value>::type value(unsigned long long& h, const vector<T>& vals){
+    tag(h, '[');
+    size_t n = vals.size();
+    bytes(h, &n, sizeof(n));
+    for(size_t i=0;i<n;i++){ value(h, static_cast<const T&>(vals[i])); }
+}
+
+}//namespace json_snapshot_hash
+
+class JSON_Snapshots {
+private:
+    //What's remembered about each key between snapshots
+    struct Node {
+        unsigned long long hash;
+        bool isObject;
+        unsigned int snapshot;//last snapshot this key was written in
+        map<string, unique_ptr<Node> > children;//owned through pointers: Node isn't complete here
+
+        Node(): hash(0), isObject(false), snapshot(0) {}
+    };
+
+    string base;
+    unsigned int keyframeEvery, count;//count = snapshots begun so far
+    bool keyframe, inSnapshot;
+    JSON_File out;
+
+    Node root;
+    vector<Node*> nodes;//open objects (nodes[0] = root)
+    vector<string> names;//their names
+    int opened;//how many of names are actually open in out (objects are only opened once something in them changed)
+
+    void materialize();
+    void remove_stale(Node& parent);
+    template <class T>
+    bool changed(string name, const T& val);
+
+public:
+    struct SNAPSHOT_ERROR : public exception {
+        string message;
+
+        SNAPSHOT_ERROR(string m): message(m) {}
+        const char* what() const throw(){ return message.c_str(); }//for c++
+    };
+
+    /**
+     * @param  filename : base file name (snapshot k goes to filename.k.full.json / filename.k.delta.json)
+     * @param  every    : write a full keyframe every this many snapshots (1 = always full)
+     */
+    JSON_Snapshots(string filename, unsigned int every = 10): base(filename), keyframeEvery(every == 0 ? 1 : every),
+                                                             count(0), keyframe(false), inSnapshot(false), opened(0) {}
+    ~JSON_Snapshots(){
+        if(inSnapshot){
+            //never throws (that would terminate while another exception unwinds); when one is
+            //unwinding the snapshot is incomplete, so it's only closed, without the removals
+            #if __cplusplus >= 201703L
+                bool unwinding = (std::uncaught_exceptions() > 0);
+            #else
+                bool unwinding = std::uncaught_exception();
+            #endif
+            try {
+                if(unwinding) out.close();
+                else this->end();
+            } catch(exception* e){
+                delete e;
+            } catch(...){}
+            inSnapshot = false;
+        }
+    }
+
+    /**
+     * Description: starts the next snapshot
+     *
+     * @return unsigned int : its number
+     */
+    unsigned int begin();
+    /**
+     * Description: writes the removals and closes the snapshot's file
+     *
+     * @return void
+     */
+    void end();
+
+    JSON_Snapshots& open_object(string name);
+    void close_object();
+
+    template <class T>
+    JSON_Snapshots& print_element(string name, T val);
+    template <class T>
+    JSON_Snapshots& print_array(string name, vector<T> data);
+    template <class T>
+    JSON_Snapshots& print_array(string name, std::initializer_list<T> data){ return print_array(name, vector<T>(data)); }
+
+    bool isKeyframe(){ return keyframe; }
+    int getCurrentLevel(){ return nodes.size() - 1; }
+};
+
+
+/**
+ * Implementations of JSON_Snapshots
+ */
+unsigned int JSON_Snapshots::begin(){
+    if(inSnapshot){ throw new SNAPSHOT_ERROR("CALLED JSON_Snapshots::begin() BEFORE end()"); }
+
+    keyframe = (count % keyframeEvery == 0);
+    out.open(base + "." + to_string(count) + (keyframe ? ".full" : ".delta"));
+
+    nodes.assign(1, &root);
+    names.assign(1, "");
+    opened = 1;
+    root.snapshot = count;
+    inSnapshot = true;
+
+    return count++;
+}
+
+void JSON_Snapshots::end(){
+    if(!inSnapshot){ throw new SNAPSHOT_ERROR("CALLED JSON_Snapshots::end() BEFORE begin()"); }
+
+    //anything left open is closed like JSON_File::close() would
+    while(nodes.size() > 1){ close_object(); }
+    remove_stale(root);
+
+    out.close();
+    inSnapshot = false;
+}
+
+//Open every object on the way down to the current one that isn't open in the file yet
+void JSON_Snapshots::materialize(){
+    for(;opened < names.size();opened++){
+        out.open_object(names[opened]);
+    }
+}
+
+//Keys of parent not written in this snapshot were removed: write them as null and forget them
+void JSON_Snapshots::remove_stale(Node& parent){
+    unsigned int current = count - 1;
+    for(map<string, unique_ptr<Node> >::iterator it = parent.children.begin(); it != parent.children.end();){
+        if(it->second->snapshot != current){
+            if(!keyframe){
+                materialize();
+                out.print_element(it->first, nullptr);
+            }
+            parent.children.erase(it++);
+        } else {
+            it++;
+        }
+    }
+}
+
+//Records the value's hash and reports whether it has to be written
+template <class T>
+bool JSON_Snapshots::changed(string name, const T& val){
+    unsigned long long h = 14695981039346656037ULL;
+    json_snapshot_hash::value(h, val);
+
+    map<string, unique_ptr<Node> >& children = nodes.back()->children;
+    map<string, unique_ptr<Node> >::iterator it = children.find(name);
+    if(it != children.end() && it->second->snapshot == count - 1){
+        throw new SNAPSHOT_ERROR("DUPLICATE KEY \"" + name + "\" IN ONE JSON_Snapshots SNAPSHOT");
+    }
+    bool differs = (it == children.end() || it->second->isObject || it->second->hash != h);
+
+    if(it == children.end()){ it = children.insert(make_pair(name, unique_ptr<Node>(new Node()))).first; }
+    Node& node = *it->second;
+
+    node.hash = h;
+    node.isObject = false;
+    node.children.clear();
+    node.snapshot = count - 1;
+
+    return keyframe || differs;
+}
+
+JSON_Snapshots& JSON_Snapshots::open_object(string name){
+    if(!inSnapshot){ throw new SNAPSHOT_ERROR("CALLED JSON_Snapshots::open_object() OUTSIDE begin()/end()"); }
+
+    map<string, unique_ptr<Node> >::iterator it = nodes.back()->children.find(name);
+    if(it != nodes.back()->children.end() && it->second->snapshot == count - 1){
+        throw new SNAPSHOT_ERROR("DUPLICATE KEY \"" + name + "\" IN ONE JSON_Snapshots SNAPSHOT");
+    }
+    bool isNew = (it == nodes.back()->children.end() || !it->second->isObject);
+
+    unique_ptr<Node>& slot = nodes.back()->children[name];
+    if(isNew){ slot.reset(new Node()); }
+    Node& node = *slot;
+    node.isObject = true;
+    node.snapshot = count - 1;
+
+    nodes.push_back(&node);
+    names.push_back(name);
+
+    //a new object has to show up even if it stays empty
+    if(keyframe || isNew){ materialize(); }
+
+    return *this;//chaining
+}
+
+void JSON_Snapshots::close_object(){
+    if(!inSnapshot){ throw new SNAPSHOT_ERROR("CALLED JSON_Snapshots::close_object() OUTSIDE begin()/end()"); }
+    if(nodes.size() <= 1){ throw new SNAPSHOT_ERROR("CALLED JSON_Snapshots::close_object() WITH NO OBJECT OPEN"); }
+
+    remove_stale(*nodes.back());
+
+    if(opened == nodes.size()){
+        out.close_object();
+        opened--;
+    }
+    nodes.pop_back();
+    names.pop_back();
+}
+
+template <class T>
+JSON_Snapshots& JSON_Snapshots::print_element(string name, T val){
+    if(!inSnapshot){ throw new SNAPSHOT_ERROR("CALLED JSON_Snapshots::print_element() OUTSIDE begin()/end()"); }
+
+    if(changed(name, val)){
+        materialize();
+        out.print_element(name, val);
+    }
+
+    return *this;//chaining
+}
+
+template <class T>
+JSON_Snapshots& JSON_Snapshots::print_array(string name, vector<T> data){
+    if(!inSnapshot){ throw new SNAPSHOT_ERROR("CALLED JSON_Snapshots::print_array() OUTSIDE begin()/end()"); }
+
+    if(changed(name, data)){
+        materialize();
+        out.print_array(name, data);
+    }
+
+    return *this;//chaining
+}
+
+#endif
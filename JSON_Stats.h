@@ -0,0 +1,125 @@
+/**
+ * Author: Ethan Dickey
+ *
+ * Writer statistics for JSON_File.  Only used when JSON_FILE_STATS is 1 (it defaults to 0,
+ * in which case none of this is compiled into JSON_File):
+ *
+ *     g++ -std=c++11 -DJSON_FILE_STATS=1 main.cpp
+ *
+ * The counting happens in two places: JSON_File bumps the token counters, and
+ * json_stats::filebuf counts bytes/flushes and times the actual writes to disk.  The
+ * filebuf only looks at the clock when it really does I/O (once per buffer), so the
+ * per-token cost is a handful of increments.
+ */
+#ifndef JSON_STATS_H
+#define JSON_STATS_H
+
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "JSON_Hash.h"
+
+namespace json_stats {
+
+typedef std::chrono::steady_clock clock;
+
+/**
+ * Snapshot returned by JSON_File::stats()
+ */
+struct Stats {
+    unsigned long long bytes;           //bytes handed to the stream (buffered or not)
+    unsigned long long flushes;         //times the buffer actually went to the OS
+    unsigned long long ioNanoseconds;   //time spent inside those writes
+
+    unsigned long long objects, arrays, subArrays;//opened containers
+    unsigned long long strings, ints, doubles, bools, nulls, binaries;//values
+
+    int maxDepth;                       //deepest brackets.size() seen
+    unsigned long long failedDumps;     //side files dump_stats couldn't open
+
+    //bytes written under each top-level key, in file order (duplicate keys are listed twice)
+    std::vector<std::pair<std::string, unsigned long long> > topLevelBytes;
+
+    Stats(): bytes(0), flushes(0), ioNanoseconds(0), objects(0), arrays(0), subArrays(0),
+             strings(0), ints(0), doubles(0), bools(0), nulls(0), binaries(0), maxDepth(0), failedDumps(0) {}
+
+    unsigned long long tokens() const { return objects + arrays + subArrays + strings + ints + doubles + bools + nulls + binaries; }
+};
+
+/**
+ * A (hashing) filebuf that keeps count of what goes through it.  Every call that can reach the
+ * OS (overflow, sync, and xsputn when the data doesn't fit in the buffer) is timed, and
+ * everything written is "bytes that came in" minus "bytes still sitting in the buffer".
+ */
+class filebuf : public json_hash::filebuf {
+private:
+    unsigned long long written, flushCount, ioTime;
+    void (*onFlush)(void*);//called after every real write (used for periodic dumps)
+    void* onFlushContext;
+
+    long long pending() const { return this->pptr() - this->pbase(); }
+
+    bool busy;//filebuf::xsputn may call our overflow() -- only count the outer call
+
+    template <class F>
+    void timed(long long added, F call){
+        if(busy){ call(); return; }
+
+        busy = true;
+        long long before = pending();
+        clock::time_point start = clock::now();
+        call();
+        ioTime += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+        busy = false;
+
+        long long sent = before + added - pending();
+        written += sent;
+        if(sent > 0){
+            flushCount++;
+            if(onFlush) onFlush(onFlushContext);
+        }
+    }
+
+protected:
+    int_type overflow(int_type c){
+        int_type result;
+        timed(traits_type::eq_int_type(c, traits_type::eof()) ? 0 : 1, [&]{ result = json_hash::filebuf::overflow(c); });
+        return result;
+    }
+    int sync(){
+        int result;
+        timed(0, [&]{ result = json_hash::filebuf::sync(); });
+        return result;
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n){
+        //fits in the buffer: just a copy, nothing to time
+        if(n < this->epptr() - this->pptr()){
+            traits_type::copy(this->pptr(), s, n);
+            this->pbump(n);
+            return n;
+        }
+
+        std::streamsize result;
+        timed(n, [&]{ result = json_hash::filebuf::xsputn(s, n); });
+        return result;
+    }
+
+public:
+    filebuf(): written(0), flushCount(0), ioTime(0), onFlush(0), onFlushContext(0), busy(false) {}
+
+    void reset(){ json_hash::filebuf::reset(); written = flushCount = ioTime = 0; }
+    void set_on_flush(void (*f)(void*), void* context){ onFlush = f; onFlushContext = context; }
+
+    unsigned long long bytes() const { return written + pending(); }
+    unsigned long long flushes() const { return flushCount; }
+    unsigned long long io_nanoseconds() const { return ioTime; }
+};
+
+typedef json_hash::basic_ofstream<filebuf> ofstream;
+
+}//namespace json_stats
+
+#endif
@@ -0,0 +1,598 @@
+/**
+ * Author: Ethan Dickey
+ *
+ * Benchmarks for JSON_File.  Build and run with
+ *
+ *     ./runProgram.sh bench [scale] [results file]
+ *
+ * or by hand: g++ -std=c++11 -O2 benchmark.cpp -o bench.out && ./bench.out [scale] [results file]
+ * (add -DJSON_FILE_STATS=1 and/or -march=native to compare builds).
+ *
+ * Every workload writes a real file, reports MB/s, ns/token, heap allocations and peak RSS
+ * on stdout, and the same numbers go into a JSON results file (default benchResults.out.json)
+ * so two builds can be diffed.  Workloads marked OWN_FILES write (or read) their own files
+ * instead of the scratch file, which isn't opened for them (MB = size of their files).  The
+ * query workloads read a file written beforehand (tokens = values found); the ones that don't
+ * look for values (NO_TOKENS) report n/a for tokens and ns/token.
+ */
+#include "JSON_File.h"
+#include "JSON_Snapshots.h"
+#include "JSON_Reader.h"
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#ifdef __GLIBC__
+    #include <malloc.h>
+#endif
+#include <sys/resource.h>
+
+using namespace std;
+
+//Runs per workload (best time is reported)
+#define REPEATS             5
+//Scratch file every workload writes to (".json" is appended)
+#define SCRATCH_FILE        "benchScratch.out"
+//Workloads that write their own files (snapshots) add their sizes here
+static unsigned long long sideBytes = 0;
+//Inputs a workload needs are built by its prepare hook before the timer starts, so only the
+//writing is timed and counted; they're freed again after the workload
+struct Inputs {
+    vector<int> ints;
+    vector<double> doubles;
+    vector<string> strings;
+    vector<unsigned char> blob;
+    vector<tuple<int, const char*, double, bool> > table;
+
+    void clear(){ Inputs empty; swap(*this, empty); }
+};
+static Inputs inputs;
+//File the query workloads read (written by mixedRecords before they run)
+#define QUERY_FILE          "benchQuery.out"
+static unsigned long long queryBytes = 0;
+static int queryRecords = 0;
+
+/**
+ * Allocation counting (every operator new in the process goes through here)
+ */
+static unsigned long long allocations = 0;
+void* operator new(size_t size){
+    allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if(!p) throw bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/**
+ * Peak RSS in KB.  On Linux the high water mark can be reset between workloads by writing
+ * 5 to /proc/self/clear_refs, otherwise this is the peak of the whole process so far.
+ * Heap pages that malloc keeps around after earlier workloads still count.
+ */
+void resetPeakRSS(){
+    #ifdef __GLIBC__
+        malloc_trim(0);//hand back what earlier workloads freed, or it counts against the next one
+    #endif
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if(f){ fputs("5", f); fclose(f); }
+}
+long peakRSS(){
+    FILE* f = fopen("/proc/self/status", "r");
+    if(f){
+        char line[256];
+        long kb = -1;
+        while(fgets(line, sizeof(line), f)){
+            if(sscanf(line, "VmHWM: %ld kB", &kb) == 1) break;
+        }
+        fclose(f);
+        if(kb != -1) return kb;
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * Workloads.  Each writes into an open JSON_File and returns the number of tokens
+ * (values + opened containers) it wrote.
+ */
+//One object with lots of keys
+long long wideObject(JSON_File& json, int scale);
+//Objects nested 64 deep, unwound with close_until (like testCloseUntil)
+long long deepNesting(JSON_File& json, int scale);
+//Big int and double arrays
+void prepareNumericArrays(int scale);
+long long numericArrays(JSON_File& json, int scale);
+//Big string array
+void prepareStringArrays(int scale);
+long long stringArrays(JSON_File& json, int scale);
+//2d and 3d arrays built from sub arrays (like twoDArrays)
+long long subArrays(JSON_File& json, int scale);
+//Objects of mixed fields, one per record
+long long mixedRecords(JSON_File& json, int scale);
+//Base64 blobs
+void prepareBinaryBlobs(int scale);
+long long binaryBlobs(JSON_File& json, int scale);
+//Heterogeneous rows: vector<tuple> and print_values
+void prepareTupleRows(int scale);
+long long tupleRows(JSON_File& json, int scale);
+//The same records row-wise (an object per record) and columnar (JSON_Columns)
+long long rowRecords(JSON_File& json, int scale);
+long long columnarRecords(JSON_File& json, int scale);
+//The same slowly changing state dumped repeatedly: in full every time, and as JSON_Snapshots deltas
+long long stateDumpsFull(JSON_File& json, int scale);
+long long stateDumpsDelta(JSON_File& json, int scale);
+//mixedRecords in canonical mode with the inline hash, keys as written and sorted
+long long canonicalRecords(JSON_File& json, int scale);
+long long canonicalSortedRecords(JSON_File& json, int scale);
+//JSON_Reader on QUERY_FILE: 8 paths in one pass, the same 8 one at a time, the whole file as
+//one value (a full structural scan) -- and reading the file into memory, which any full parse
+//has to do at least
+void prepareQueries(int scale);
+long long queryBatch(JSON_File& json, int scale);
+long long querySingle(JSON_File& json, int scale);
+long long queryFullScan(JSON_File& json, int scale);
+long long readWholeFile(JSON_File& json, int scale);
+
+//Workload flags
+#define OWN_FILES           1//gets an unopened JSON_File, counts its bytes in sideBytes
+#define NO_TOKENS           2//doesn't write or find values: no tokens or ns/token
+
+struct Workload {
+    string name;
+    long long (*run)(JSON_File&, int);
+    void (*prepare)(int);//fills inputs (untimed), may be null
+    int flags;
+};
+
+struct Result {
+    string name;
+    long long tokens;
+    unsigned long long bytes, allocations;
+    double seconds;
+    long peakKB;
+};
+
+Result runWorkload(const Workload& w, int scale);
+void writeResults(const vector<Result>& results, int scale, string filename);
+
+
+
+int main(int argc, char** argv){
+    int scale = (argc > 1 ? atoi(argv[1]) : 1);
+    string resultsFile = (argc > 2 ? argv[2] : "benchResults.out");
+    if(scale < 1) scale = 1;
+
+    Workload workloads[] = {
+        {"wide object", wideObject},
+        {"deep nesting", deepNesting},
+        {"numeric arrays", numericArrays, prepareNumericArrays},
+        {"string arrays", stringArrays, prepareStringArrays},
+        {"sub arrays (2d/3d)", subArrays},
+        {"mixed records", mixedRecords},
+        {"binary blobs", binaryBlobs, prepareBinaryBlobs},
+        {"tuple rows", tupleRows, prepareTupleRows},
+        {"row records", rowRecords},
+        {"columnar records", columnarRecords},
+        {"state dumps (full)", stateDumpsFull, 0, OWN_FILES},
+        {"state dumps (delta)", stateDumpsDelta, 0, OWN_FILES},
+        {"canonical + hash", canonicalRecords, 0, OWN_FILES},
+        {"canonical sorted", canonicalSortedRecords, 0, OWN_FILES},
+        {"query 8 paths", queryBatch, prepareQueries, OWN_FILES},
+        {"query 8 paths x1", querySingle, prepareQueries, OWN_FILES},
+        {"query full scan", queryFullScan, 0, OWN_FILES | NO_TOKENS},
+        {"read whole file", readWholeFile, 0, OWN_FILES | NO_TOKENS},
+    };
+
+    //file for the query workloads
+    {
+        JSON_File query(QUERY_FILE);
+        mixedRecords(query, scale);
+        query.close();
+        ifstream file(QUERY_FILE ".json", ios::binary | ios::ate);
+        queryBytes = file.tellg();
+        queryRecords = 50000 * scale;
+    }
+
+    vector<Result> results;
+    printf("%-20s %10s %12s %10s %10s %12s %10s\n", "workload", "MB", "tokens", "MB/s", "ns/token", "allocs", "peak KB");
+    for(int i=0;i<sizeof(workloads)/sizeof(workloads[0]);i++){
+        Result r = runWorkload(workloads[i], scale);
+        char tokens[32] = "n/a", perToken[32] = "n/a";
+        if(r.tokens > 0){
+            snprintf(tokens, sizeof(tokens), "%lld", r.tokens);
+            snprintf(perToken, sizeof(perToken), "%.2f", r.seconds * 1e9 / r.tokens);
+        }
+        printf("%-20s %10.2f %12s %10.1f %10s %12llu %10ld\n", r.name.c_str(), r.bytes / 1e6, tokens,
+               r.bytes / 1e6 / r.seconds, perToken, r.allocations, r.peakKB);
+        results.push_back(r);
+    }
+    remove(SCRATCH_FILE ".json");
+    remove(QUERY_FILE ".json");
+
+    writeResults(results, scale, resultsFile);
+
+    return 0;
+}
+
+/**
+ * Timing and reporting
+ */
+Result runWorkload(const Workload& w, int scale){
+    Result best;
+    best.name = w.name;
+    best.seconds = -1;
+
+    if(w.prepare) w.prepare(scale);
+    for(int i=0;i<REPEATS;i++){
+        resetPeakRSS();
+        unsigned long long allocsBefore = allocations;
+        sideBytes = 0;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        JSON_File json;
+        if(!(w.flags & OWN_FILES)) json.open(SCRATCH_FILE);
+        long long tokens = w.run(json, scale);
+        if(json.isInitialized()) json.close();
+        if(w.flags & NO_TOKENS) tokens = 0;
+
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if(best.seconds < 0 || seconds < best.seconds){
+            best.seconds = seconds;
+            best.tokens = tokens;
+            best.allocations = allocations - allocsBefore;
+            best.peakKB = peakRSS();
+
+            best.bytes = sideBytes;
+            if(!(w.flags & OWN_FILES)){
+                ifstream file(SCRATCH_FILE ".json", ios::binary | ios::ate);
+                best.bytes += (unsigned long long)file.tellg();
+            }
+        }
+    }
+    inputs.clear();
+
+    return best;
+}
+
+void writeResults(const vector<Result>& results, int scale, string filename){
+    JSON_File json(filename);
+
+    #ifdef __OPTIMIZE__
+        bool optimized = true;
+    #else
+        bool optimized = false;
+    #endif
+
+    json.open_object("build")
+        .print_element("compiler", __VERSION__)
+        .print_element("optimized", optimized)
+        .print_element("JSON_FILE_STATS", JSON_FILE_STATS)
+    #if defined(__AVX2__)
+        .print_element("simd", "avx2")
+    #elif defined(__SSSE3__)
+        .print_element("simd", "ssse3")
+    #else
+        .print_element("simd", "none")
+    #endif
+        .print_element("scale", scale)
+        .print_element("repeats", REPEATS)
+        .close_object();
+
+    json.open_object("results");
+    for(int i=0;i<results.size();i++){
+        const Result& r = results[i];
+        json.open_object(r.name)
+            .print_element("bytes", (long long)r.bytes)
+            .print_element("seconds", r.seconds)
+            .print_element("MB/s", r.bytes / 1e6 / r.seconds);
+        if(r.tokens > 0){
+            json.print_element("tokens", (long long)r.tokens)
+                .print_element("ns/token", r.seconds * 1e9 / r.tokens);
+        } else {
+            json.print_element("tokens", nullptr)
+                .print_element("ns/token", nullptr);
+        }
+        json.print_element("allocations", (long long)r.allocations)
+            .print_element("peak RSS KB", (long long)r.peakKB)
+            .close_object();
+    }
+    json.close();
+}
+
+/**
+ * Workloads
+ */
+//One object with lots of keys
+long long wideObject(JSON_File& json, int scale){
+    int keys = 100000 * scale;
+    string key = "key ";
+
+    json.open_object("wide");
+    for(int i=0;i<keys;i++){
+        key.resize(4);
+        key += to_string(i);
+        if(i & 1) json.print_element(key, i * 0.5);
+        else      json.print_element(key, i);
+    }
+    json.close_object();
+
+    return keys + 1;
+}
+
+//Objects nested 64 deep, unwound with close_until (like testCloseUntil)
+long long deepNesting(JSON_File& json, int scale){
+    int rounds = 1000 * scale, depth = 64;
+
+    for(int r=0;r<rounds;r++){
+        json.open_object("round " + to_string(r));
+        for(int d=1;d<depth;d++){
+            json.open_object("level");
+        }
+        json.print_element("bottom", r);
+        json.close_until(0);
+    }
+
+    return (long long)rounds * (depth + 1);
+}
+
+//Big int and double arrays
+void prepareNumericArrays(int scale){
+    int n = 500000 * scale;
+    inputs.ints.resize(n);
+    inputs.doubles.resize(n);
+    for(int i=0;i<n;i++){
+        inputs.ints[i] = i * 7919;
+        inputs.doubles[i] = i / 3.0;
+    }
+}
+long long numericArrays(JSON_File& json, int scale){
+    json.print_array("ints", inputs.ints);
+    json.print_array("doubles", inputs.doubles);
+
+    return 2LL * inputs.ints.size() + 2;
+}
+
+//Big string array
+void prepareStringArrays(int scale){
+    int n = 200000 * scale;
+    inputs.strings.resize(n);
+    for(int i=0;i<n;i++){
+        inputs.strings[i] = "string number " + to_string(i);
+    }
+}
+long long stringArrays(JSON_File& json, int scale){
+    json.print_array("strings", inputs.strings);
+
+    return inputs.strings.size() + 1;
+}
+
+//2d and 3d arrays built from sub arrays (like twoDArrays)
+long long subArrays(JSON_File& json, int scale){
+    int rows = 50000 * scale;
+    vector<int> row({1, 2, 5, 6});
+    long long tokens = 0;
+
+    //2d: rows x 4
+    json.open_array("2d");
+    for(int i=0;i<rows;i++){
+        json.print_sub_array(row);
+    }
+    json.close_array();
+    tokens += 1 + rows * (1 + row.size());
+
+    //3d: (rows/10) x 10 x 4
+    json.open_array("3d");
+    for(int i=0;i<rows/10;i++){
+        json.open_sub_array();
+        for(int j=0;j<10;j++){
+            json.print_sub_array(row);
+        }
+        json.close_sub_array();
+    }
+    json.close_array();
+    tokens += 1 + (rows/10) * (1 + 10 * (1 + row.size()));
+
+    return tokens;
+}
+
+//Objects of mixed fields, one per record
+long long mixedRecords(JSON_File& json, int scale){
+    int records = 50000 * scale;
+    vector<int> values(3);
+
+    json.open_object("records");
+    for(int i=0;i<records;i++){
+        values[0] = i;
+        values[1] = i + 1;
+        values[2] = i + 2;
+        json.open_object("record " + to_string(i))
+            .print_element("id", i)
+            .print_element("name", "record name")
+            .print_element("score", i * 1.25)
+            .print_element("flag", (i & 1) == 1)
+            .print_array("values", values)
+            .close_object();
+    }
+    json.close_object();
+
+    return 1 + (long long)records * 9;
+}
+
+//Base64 blobs
+void prepareBinaryBlobs(int scale){
+    inputs.blob.resize(4096);
+    for(int i=0;i<inputs.blob.size();i++){ inputs.blob[i] = (i * 131 + 7) & 0xff; }
+}
+long long binaryBlobs(JSON_File& json, int scale){
+    int blobs = 2000 * scale;
+
+    json.open_array("blobs");
+    for(int i=0;i<blobs;i++){
+        json.print_binary(inputs.blob.data(), inputs.blob.size());
+    }
+    json.close_array();
+
+    return blobs + 1;
+}
+
+//Heterogeneous rows: vector<tuple> and print_values
+void prepareTupleRows(int scale){
+    int rows = 100000 * scale;
+    inputs.table.resize(rows);
+    for(int i=0;i<rows;i++){
+        inputs.table[i] = make_tuple(i, "row name", i * 1.25, (i & 1) == 1);
+    }
+}
+long long tupleRows(JSON_File& json, int scale){
+    int rows = inputs.table.size();
+
+    json.print_array("vector<tuple>", inputs.table);
+
+    json.open_array("print_values");
+    for(int i=0;i<rows;i++){
+        json.print_values(i, "row name", i * 1.25, (i & 1) == 1);
+    }
+    json.close_array();
+
+    return 2 + (long long)rows * 5 + (long long)rows * 4;
+}
+
+//The same records row-wise (an object per record) and columnar (JSON_Columns)
+#define RECORDS_PER_SCALE   100000
+long long rowRecords(JSON_File& json, int scale){
+    int records = RECORDS_PER_SCALE * scale;
+    string key = "record ";
+
+    json.open_object("records");
+    for(int i=0;i<records;i++){
+        key.resize(7);
+        key += to_string(i);
+        json.open_object(key)
+            .print_element("id", i)
+            .print_element("name", "record name")
+            .print_element("score", i * 1.25)
+            .print_element("flag", (i & 1) == 1)
+            .close_object();
+    }
+    json.close_object();
+
+    return 1 + (long long)records * 5;
+}
+long long columnarRecords(JSON_File& json, int scale){
+    int records = RECORDS_PER_SCALE * scale;
+
+    JSON_Columns<int, const char*, double, bool> cols(json, "records", {"id", "name", "score", "flag"}, 8192);
+    for(int i=0;i<records;i++){
+        cols.add(i, "record name", i * 1.25, (i & 1) == 1);
+    }
+    cols.close();
+
+    return 1 + (long long)records * 4;
+}
+
+//The same slowly changing state dumped repeatedly: in full every time, and as JSON_Snapshots deltas
+#define DUMPS               20
+#define GROUPS              200
+#define KEYS_PER_GROUP      100
+//1 in this many values changes between dumps
+#define CHANGE_EVERY        100
+unsigned long long fileSize(string filename){
+    ifstream file(filename.c_str(), ios::binary | ios::ate);
+    unsigned long long size = file.tellg();
+    file.close();
+    remove(filename.c_str());
+    return size;
+}
+//Writes dump d of the state with either writer (both have open_object/print_element/close_object)
+template <class W>
+long long writeState(W& json, int dump, int scale){
+    string group = "group ", key = "key ";
+    for(int g=0;g<GROUPS * scale;g++){
+        group.resize(6);
+        group += to_string(g);
+        json.open_object(group);
+        for(int k=0;k<KEYS_PER_GROUP;k++){
+            key.resize(4);
+            key += to_string(k);
+            int id = g * KEYS_PER_GROUP + k;
+            json.print_element(key, (id % CHANGE_EVERY == dump % CHANGE_EVERY ? dump : 0) + id * 0.5);
+        }
+        json.close_object();
+    }
+    return (long long)GROUPS * scale * (KEYS_PER_GROUP + 1);
+}
+long long stateDumpsFull(JSON_File& json, int scale){
+    long long tokens = 0;
+    for(int d=0;d<DUMPS;d++){
+        JSON_File dump(SCRATCH_FILE ".state." + to_string(d));
+        tokens += writeState(dump, d, scale);
+        dump.close();
+        sideBytes += fileSize(SCRATCH_FILE ".state." + to_string(d) + ".json");
+    }
+    return tokens;
+}
+long long stateDumpsDelta(JSON_File& json, int scale){
+    long long tokens = 0;
+    JSON_Snapshots snaps(SCRATCH_FILE ".state", 10);
+    for(int d=0;d<DUMPS;d++){
+        bool keyframe = (snaps.begin(), snaps.isKeyframe());
+        tokens += writeState(snaps, d, scale);
+        snaps.end();
+        sideBytes += fileSize(SCRATCH_FILE ".state." + to_string(d) + (keyframe ? ".full.json" : ".delta.json"));
+    }
+    return tokens;
+}
+
+//mixedRecords in canonical mode with the inline hash (set_canonical has to come before open,
+//so these write their own file)
+long long canonicalWrite(int scale, size_t sortKeysUpTo){
+    JSON_File canonical;
+    canonical.set_canonical(true, JSON_File::DUPLICATES_THROW, sortKeysUpTo);
+    canonical.set_hashing(true);
+    canonical.open(SCRATCH_FILE ".canonical");
+    long long tokens = mixedRecords(canonical, scale);
+    canonical.close();
+    sideBytes += fileSize(SCRATCH_FILE ".canonical.json");
+    return tokens;
+}
+long long canonicalRecords(JSON_File& json, int scale){ return canonicalWrite(scale, 0); }
+long long canonicalSortedRecords(JSON_File& json, int scale){ return canonicalWrite(scale, 1 << 20); }
+
+//Spread over the file, the last one near the end
+void prepareQueries(int scale){
+    for(int i=1;i<=8;i++){
+        int record = (long long)queryRecords * i / 8 - 1;
+        inputs.strings.push_back("/records/record " + to_string(record) + (i % 2 ? "/score" : "/values/2"));
+    }
+}
+long long queryBatch(JSON_File& json, int scale){
+    JSON_Reader reader(QUERY_FILE);
+    vector<JSON_Value> values = reader.find(inputs.strings);
+    long long found = 0;
+    for(int i=0;i<values.size();i++){ found += (values[i].as_double() >= 0); }
+    sideBytes += queryBytes;
+    return found;
+}
+long long querySingle(JSON_File& json, int scale){
+    JSON_Reader reader(QUERY_FILE);
+    const vector<string>& paths = inputs.strings;
+    long long found = 0;
+    for(int i=0;i<paths.size();i++){ found += (reader.find(paths[i]).as_double() >= 0); }
+    sideBytes += queryBytes;
+    return found;
+}
+long long queryFullScan(JSON_File& json, int scale){
+    JSON_Reader reader(QUERY_FILE);
+    sideBytes += queryBytes;
+    return reader.find("").type() == JSON_Value::OBJECT;
+}
+long long readWholeFile(JSON_File& json, int scale){
+    ifstream file(QUERY_FILE ".json", ios::binary);
+    string text(queryBytes, ' ');
+    file.read(&text[0], queryBytes);
+    sideBytes += queryBytes;
+    return text[0] == '{';
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Author: Ethan Dickey
+
+Compares two sets of benchmark results (benchmark.cpp's results files) workload by workload:
+median MB/s of each set and how much slower/faster the second set is.  Each set can be several
+runs (comma separated) so alternating runs of two builds can be compared, e.g. via
+
+    ./runProgram.sh bench-stats [scale] [rounds]
+
+With --limit PCT every workload the second set is more than PCT percent slower on is flagged,
+and the exit status is 1 if there are any.
+
+usage: python3 compareBench.py [--limit PCT] <base.json>[,<base2.json>...] <other.json>[,<other2.json>...] [label] [label]
+"""
+import json
+import math
+import statistics
+import sys
+
+
+def median_rates(files):
+    rates = {}
+    order = []
+    for name in files.split(','):
+        with open(name) as f:
+            results = json.load(f)['results']
+        for workload, r in results.items():
+            if workload not in rates:
+                order.append(workload)
+                rates[workload] = []
+            rates[workload].append(r['MB/s'])
+    return order, {workload: statistics.median(r) for workload, r in rates.items()}
+
+
+def main():
+    args = sys.argv[1:]
+    limit = None
+    if len(args) > 1 and args[0] == '--limit':
+        limit = float(args[1])
+        args = args[2:]
+    if len(args) < 2:
+        print(__doc__.strip().splitlines()[-1])
+        sys.exit(1)
+    labels = (args[2:4] + ['base', 'other'])[:2]
+
+    order, base = median_rates(args[0])
+    _, other = median_rates(args[1])
+
+    print('%-20s %12s %12s %9s' % ('workload', labels[0] + ' MB/s', labels[1] + ' MB/s', 'delta'))
+    logs = []
+    over = []
+    for workload in order:
+        if workload not in other:
+            continue
+        delta = other[workload] / base[workload] - 1
+        logs.append(math.log(other[workload] / base[workload]))
+        flag = ''
+        if limit is not None and -delta * 100 > limit:
+            over.append(workload)
+            flag = '  over %g%%' % limit
+        print('%-20s %12.1f %12.1f %+8.1f%%%s' % (workload, base[workload], other[workload], delta * 100, flag))
+    print('%-20s %12s %12s %+8.1f%%' % ('geometric mean', '', '', (math.exp(sum(logs) / len(logs)) - 1) * 100))
+    if over:
+        print('%d workload(s) more than %g%% slower' % (len(over), limit))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -2,7 +2,10 @@
  * Author: Ethan Dickey
  */
 #include "JSON_File.h"
+#include "JSON_Snapshots.h"
+#include "JSON_Reader.h"
 #include <string>
+#include <sstream>
 
 using namespace std;
 
@@ -46,6 +49,22 @@ void chainingTest(JSON_File& json);
 // void negativeTabTest(JSON_File& json);
 //Test passing in a vector and the function detecting what type it is
 void vectorTest(JSON_File& json);
+//Test base64 binary blobs (round trip through base64::decode) (@RETURN SUCCESS)
+bool binaryTest(JSON_File& json);
+//Test heterogeneous rows: print_values, tuples, pairs (and optional/variant with C++17)
+void tupleTest(JSON_File& json);
+//Test columnar batches (@RETURN SUCCESS)
+bool columnsTest(JSON_File& json, string& message);
+//Test delta snapshots (check them with reconstructSnapshot.py) (@RETURN SUCCESS)
+bool snapshotTest(string& message);
+//Test canonical mode (escaping, numbers, duplicate keys, sorted keys) and the inline hash (@RETURN SUCCESS)
+bool canonicalTest(string& message);
+//Test path queries on the files written above (@RETURN SUCCESS)
+bool readerTest(string& message);
+#if JSON_FILE_STATS
+//Test the writer statistics against the file it wrote (only with -DJSON_FILE_STATS=1)
+bool statsTest(string& message);
+#endif
 
 
 
@@ -113,8 +132,60 @@ int main(){
     //Test using the initializer list function for print_data
     vectorTest(json2);
 
+    //Test mixed type rows
+    tupleTest(json2);
+
+    //Test columnar output
+    if(!columnsTest(json2, message)){
+        cerr << message << endl;
+        #if EXIT_ON_FAIL
+            exit(1);
+        #endif
+    }
+
+    //Test binary blobs
+    if(!binaryTest(json2)){
+        cerr << "BASE64 ROUND TRIP FAILED: EXIT()" << endl;
+        #if EXIT_ON_FAIL
+            exit(1);
+        #endif
+    }
+
     json2.close();
 
+    //Test delta snapshots
+    if(!snapshotTest(message)){
+        cerr << message << endl;
+        #if EXIT_ON_FAIL
+            exit(1);
+        #endif
+    }
+
+    //Test canonical output and hashing
+    if(!canonicalTest(message)){
+        cerr << message << endl;
+        #if EXIT_ON_FAIL
+            exit(1);
+        #endif
+    }
+
+    //Test reading values back by path
+    if(!readerTest(message)){
+        cerr << message << endl;
+        #if EXIT_ON_FAIL
+            exit(1);
+        #endif
+    }
+
+    #if JSON_FILE_STATS
+        if(!statsTest(message)){
+            cerr << message << endl;
+            #if EXIT_ON_FAIL
+                exit(1);
+            #endif
+        }
+    #endif
+
     return 0;
 }
 
@@ -443,3 +514,458 @@ void vectorTest(JSON_File& json){
     // int c[] = {7, 8, 9};
     // json.print_array(".print_array({myInts, myInts, myInts})", {a, b, c});
 }
+
+//Test base64 binary blobs (round trip through base64::decode) (@RETURN SUCCESS)
+bool binaryTest(JSON_File& json){
+    //RFC 4648 test vectors
+    string plain[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+    string coded[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+    char buffer[16];
+    for(int i=0;i<7;i++){
+        if(string(buffer, base64::encode(plain[i].data(), plain[i].size(), buffer)) != coded[i]){ return false; }
+    }
+
+    //Every length up to a few SIMD blocks, plus one that spans several print_binary blocks
+    vector<unsigned char> bytes(10000);
+    for(int i=0;i<bytes.size();i++){ bytes[i] = (i * 131 + 7) & 0xff; }
+    vector<char> text(base64::encoded_length(bytes.size()));
+    for(int len=0;len<=bytes.size();len += (len < 100 ? 1 : 4999)){
+        vector<unsigned char> decoded;
+        size_t n = base64::encode(bytes.data(), len, text.data());
+        if(n != base64::encoded_length(len) || !base64::decode(text.data(), n, decoded)){ return false; }
+        if(decoded != vector<unsigned char>(bytes.begin(), bytes.begin() + len)){ return false; }
+    }
+    vector<unsigned char> junk;
+    if(base64::decode("Zm9v!", 5, junk)){ return false; }
+
+    //padding: none, or exactly what completes the last group of 4
+    const char* malformed[] = {"QQ=====", "QQ===", "QQ=", "QUJD=", "QUI==", "=", "==", "QUJD===="};
+    for(int i=0;i<sizeof(malformed)/sizeof(malformed[0]);i++){
+        if(base64::decode(malformed[i], strlen(malformed[i]), junk)){ return false; }
+    }
+    const char* padded[] = {"QQ==", "QUI=", "QQ", "QUI", ""};
+    const char* plainText[] = {"A", "AB", "A", "AB", ""};
+    for(int i=0;i<sizeof(padded)/sizeof(padded[0]);i++){
+        vector<unsigned char> decoded;
+        if(!base64::decode(padded[i], strlen(padded[i]), decoded) || string(decoded.begin(), decoded.end()) != plainText[i]){ return false; }
+    }
+
+    json.print_binary("binary (foobar)", plain[6].data(), plain[6].size());
+    json.open_array("binary array").print_binary("f", 1).print_binary("fo", 2).print_binary(bytes.data(), 30).close_array();
+
+    return true;
+}
+
+#if JSON_FILE_STATS
+//Test the writer statistics against the file it wrote (only with -DJSON_FILE_STATS=1)
+bool statsTest(string& message){
+    JSON_File json("statsFile.out");
+    json.dump_stats_every("statsFile.stats.out", 0);//every flush
+
+    json.open_object("small").print_element("int", 1).print_element("double", 2.5).print_element("bool", true);
+    json.print_element("null", nullptr);
+    unsigned long long nulls = 1;
+    #if __cplusplus >= 201703L
+        json.print_element("empty optional", optional<int>());
+        nulls++;
+    #endif
+    json.close_object();
+    json.print_array("names", myNames);
+    json.open_array("big").open_sub_array();
+    for(int i=0;i<20000;i++){ json.print_data(myInts); }
+    json.close_until(0);
+
+    json_stats::Stats s = json.stats();
+    if(s.ints != 1 + 20000 * myInts.size() || s.doubles != 1 || s.bools != 1 || s.nulls != nulls || s.strings != myNames.size()){
+        message = "STATS: WRONG TOKEN COUNTS";
+        return false;
+    }
+    if(s.objects != 1 || s.arrays != 2 || s.subArrays != 1 || s.maxDepth != 2){
+        message = "STATS: WRONG CONTAINER COUNTS OR DEPTH";
+        return false;
+    }
+    if(s.flushes == 0 || s.topLevelBytes.size() != 3 || s.topLevelBytes[2].first != "big"){
+        message = "STATS: NO FLUSHES OR WRONG TOP LEVEL KEYS";
+        return false;
+    }
+    json.close();
+
+    //every byte in the file is accounted for, and the keys cover all but "{\n" and "\n}\n"
+    s = json.stats();
+    ifstream file("statsFile.out.json", ios::binary | ios::ate);
+    unsigned long long keyBytes = 0;
+    for(int i=0;i<s.topLevelBytes.size();i++){ keyBytes += s.topLevelBytes[i].second; }
+    if(s.bytes != (unsigned long long)file.tellg() || keyBytes + 5 != s.bytes){
+        message = "STATS: BYTE COUNT DOESN'T MATCH THE FILE";
+        return false;
+    }
+
+    ifstream side("statsFile.stats.out.json");
+    if(!side.is_open()){
+        message = "STATS: NO SIDE FILE";
+        return false;
+    }
+
+    //a side file that can't be written is skipped, the main file is unaffected
+    JSON_File broken("statsFile.out");
+    broken.dump_stats_every("/nonexistent/dir/stats", 0);
+    broken.open_array("big");
+    for(int i=0;i<5000;i++){ broken.print_data(myInts); }
+    broken.close();
+    s = broken.stats();
+    ifstream brokenFile("statsFile.out.json", ios::binary | ios::ate);
+    if(s.failedDumps == 0 || s.bytes != (unsigned long long)brokenFile.tellg()){
+        message = "STATS: FAILED SIDE FILE DUMP BROKE THE MAIN FILE";
+        return false;
+    }
+
+    //columns batches go array > batch object > "data" > column array, and leave nothing open
+    JSON_File columns("statsFile.out");
+    JSON_Columns<int, int> cols(columns, "columns", {"a", "b"});
+    cols.add(1, 2).flush();
+    s = columns.stats();
+    if(s.maxDepth != 4 || s.objects != 2 || s.arrays != 4 || columns.getCurrentLevel() != 1){
+        message = "STATS: JSON_Columns BATCH DEPTH OR CONTAINERS NOT COUNTED";
+        return false;
+    }
+    cols.close();
+    columns.close();
+
+    return true;
+}
+#endif
+
+//Test heterogeneous rows: print_values, tuples, pairs (and optional/variant with C++17)
+void tupleTest(JSON_File& json){
+    //The multiTypedArray case in one call
+    json.open_array("print_values(1, true, my, 1.1)").print_values(1, true, "my", 1.1).print_values(string("again")).close_array();
+
+    vector<tuple<int, string, double, bool> > rows;
+    rows.push_back(make_tuple(1, "first", 1.5, true));
+    rows.push_back(make_tuple(2, "second", 2.5, false));
+    json.print_array("vector<tuple<int, string, double, bool>>", rows);
+
+    json.print_element("pair", make_pair(string("key"), 2));
+    json.open_array("rows as print_values").print_values(make_tuple(3, "third"), make_pair(4, "fourth")).close_array();
+
+    #if __cplusplus >= 201703L
+        vector<optional<int> > maybe({1, nullopt, 3});
+        vector<variant<int, string, bool> > either({1, string("two"), false});
+        json.print_array("optional<int>", maybe);
+        json.print_array("variant<int, string, bool>", either);
+    #endif
+}
+
+//Test columnar batches (@RETURN SUCCESS)
+bool columnsTest(JSON_File& json, string& message){
+    //5 rows in batches of 2 -> 3 batches, the last one flushed by close()
+    JSON_Columns<int, string, double, bool> cols(json, "columns (batches of 2)", {"id", "name", "score", "flag"}, 2);
+    for(int i=0;i<5;i++){
+        cols.add(i, myNames[i % myNames.size()], myDoubles[i % myDoubles.size()], myTruths[i % myTruths.size()]);
+    }
+    if(cols.buffered() != 1){
+        message = "JSON_Columns DIDN'T FLUSH EVERY 2 ROWS";
+        return false;
+    }
+    cols.close();
+
+    //Wrong number of column names
+    try{
+        JSON_Columns<int, int> bad(json, "bad", {"only one"});
+        message = "JSON_Columns ACCEPTED THE WRONG NUMBER OF COLUMN NAMES";
+        return false;
+    } catch(JSON_File::COLUMN_COUNT_ERROR* e){ delete e; }
+
+    //Same name twice
+    try{
+        JSON_Columns<int, int> bad(json, "bad", {"twice", "twice"});
+        message = "JSON_Columns ACCEPTED A DUPLICATE COLUMN NAME";
+        return false;
+    } catch(JSON_File::DUPLICATE_KEY_ERROR* e){ delete e; }
+
+    return true;
+}
+
+//Writes the same (slowly changing) state for snapshot i
+void writeState(JSON_Snapshots& snaps, int i){
+    snaps.open_object("myObject");
+    snaps.print_array("my ints?", myInts);
+    snaps.print_element("counter", i);
+    snaps.print_element("constant", "never changes");
+    if(i < 2) snaps.print_element("removed after snapshot 1", true);
+    if(i >= 2) snaps.open_object("added in snapshot 2").print_element("i", i).close_object();
+    snaps.open_object("empty").close_object();
+    snaps.close_object();
+    snaps.print_array("big and constant", myDoubles);
+}
+
+//Test delta snapshots (check them with reconstructSnapshot.py) (@RETURN SUCCESS)
+bool snapshotTest(string& message){
+    //0 = keyframe, 1..2 = deltas, 3 = keyframe, 4 = delta
+    JSON_Snapshots snaps("snapshot.out", 3);
+    for(int i=0;i<5;i++){
+        snaps.begin();
+        if(snaps.isKeyframe() != (i % 3 == 0)){
+            message = "JSON_Snapshots WROTE A KEYFRAME AT THE WRONG TIME";
+            return false;
+        }
+        writeState(snaps, i < 4 ? i : 3);
+        snaps.end();
+    }
+
+    //Snapshot 1 only changes the counter; 2 adds an object and removes a key; 4 is the same as 3
+    ifstream delta1("snapshot.out.1.delta.json"), delta2("snapshot.out.2.delta.json"), delta4("snapshot.out.4.delta.json");
+    stringstream text1, text2, text4;
+    text1 << delta1.rdbuf();
+    text2 << delta2.rdbuf();
+    text4 << delta4.rdbuf();
+    if(text1.str() != "{\n  \"myObject\": {\n    \"counter\": 1\n  }\n}\n"){
+        message = "JSON_Snapshots DELTA HAS MORE THAN THE CHANGE: " + text1.str();
+        return false;
+    }
+    if(text2.str() != "{\n  \"myObject\": {\n    \"counter\": 2,\n    \"added in snapshot 2\": {\n      \"i\": 2\n    },\n"
+                      "    \"removed after snapshot 1\": null\n  }\n}\n"){
+        message = "JSON_Snapshots DELTA DOESN'T HOLD THE ADDED OBJECT AND THE REMOVED KEY (AS null): " + text2.str();
+        return false;
+    }
+    if(text4.str() != "{\n\n}\n"){
+        message = "JSON_Snapshots DELTA OF AN UNCHANGED STATE ISN'T EMPTY: " + text4.str();
+        return false;
+    }
+
+    //the same key twice in one snapshot (a value, then an object), but fine in the next one
+    JSON_Snapshots twice("snapshot.out.twice", 3);
+    int thrown = 0;
+    for(int i=0;i<2;i++){
+        twice.begin();
+        twice.print_element("key", i);
+        try { twice.print_element("key", i + 1); } catch(JSON_Snapshots::SNAPSHOT_ERROR* e){ thrown++; delete e; }
+        twice.open_object("object").close_object();
+        try { twice.open_object("object"); } catch(JSON_Snapshots::SNAPSHOT_ERROR* e){ thrown++; delete e; }
+        twice.end();
+    }
+    if(thrown != 4){
+        message = "JSON_Snapshots DIDN'T THROW ON A DUPLICATE KEY IN ONE SNAPSHOT";
+        return false;
+    }
+
+    //destroyed by an exception in the middle of a snapshot: closed, not terminated
+    try {
+        JSON_Snapshots unwound("snapshot.out.unwound");
+        unwound.begin();
+        unwound.open_object("half written").print_element("key", 1);
+        throw 1;
+    } catch(int){ /*success*/ }
+
+    return true;
+}
+
+//Same record written in two different key orders
+void writeCanonical(JSON_File& json, bool reversed){
+    json.open_object("record");
+    if(!reversed){
+        json.print_element("b", 0.1).print_element("a", string("tab\there \"quoted\"")).print_element("c", 1e300);
+        json.open_object("nested").print_element("y", -0.0).print_element("x", 3.0).close_object();
+        json.print_array("list", vector<double>{2.5, 1e21, 1.0/0.0});
+    } else {
+        json.print_array("list", vector<double>{2.5, 1e21, 1.0/0.0});
+        json.open_object("nested").print_element("x", 3.0).print_element("y", -0.0).close_object();
+        json.print_element("c", 1e300).print_element("a", string("tab\there \"quoted\"")).print_element("b", 0.1);
+    }
+    json.close_object();
+    json.print_element("count", 7);
+
+    //column names are keys too: escaped, and the data columns sorted
+    JSON_Columns<int, int> cols(json, "columns", {"z \"quoted\"", "a"});
+    cols.add(1, 2).close();
+}
+
+//Test canonical mode (escaping, numbers, duplicate keys, sorted keys) and the inline hash (@RETURN SUCCESS)
+bool canonicalTest(string& message){
+    JSON_File json;
+    unsigned long long hashes[2];
+    for(int i=0;i<2;i++){
+        json.set_canonical(true, JSON_File::DUPLICATES_THROW, 1 << 16);
+        json.set_hashing(true);
+        json.open("canonical.out." + to_string(i));
+        writeCanonical(json, i == 1);
+        hashes[i] = json.close();
+    }
+
+    //key order doesn't matter once sorted
+    ifstream file0("canonical.out.0.json"), file1("canonical.out.1.json");
+    stringstream text0, text1;
+    text0 << file0.rdbuf();
+    text1 << file1.rdbuf();
+    if(text0.str() != text1.str() || hashes[0] != hashes[1]){
+        message = "CANONICAL OUTPUT DEPENDS ON KEY ORDER:\n" + text0.str() + "\n" + text1.str();
+        return false;
+    }
+    if(text0.str().find("\"a\": \"tab\\there \\\"quoted\\\"\",\n    \"b\": 0.1,\n    \"c\": 1e+300") == string::npos
+       || text0.str().find("\"x\": 3,\n      \"y\": 0") == string::npos
+       || text0.str().find("2.5, 1e+21, null") == string::npos
+       || text0.str().find("\"cols\": [\"z \\\"quoted\\\"\", \"a\"]") == string::npos
+       || text0.str().find("\"a\": [2],\n        \"z \\\"quoted\\\"\": [1]") == string::npos){
+        message = "CANONICAL OUTPUT IS NOT CANONICAL:\n" + text0.str();
+        return false;
+    }
+
+    //the inline hash is the hash of the file
+    json_hash::xxh64 check;
+    check.update(text0.str().data(), text0.str().size());
+    if(check.digest() != hashes[0] || json.hash() != hashes[1]){
+        message = "JSON_File::close() HASH DOESN'T MATCH THE FILE";
+        return false;
+    }
+
+    //duplicate keys
+    json.set_canonical(true);
+    json.open("canonical.out.2");
+    json.open_object("object").print_element("key", 1);
+    bool thrown = false;
+    try {
+        json.print_element("key", 2);
+    } catch(JSON_File::DUPLICATE_KEY_ERROR* e){
+        thrown = true;
+        delete e;
+    }
+    json.close_object();
+    json.print_element("key", 3);//a different object, fine
+    json.close();
+    if(!thrown){
+        message = "CANONICAL MODE DIDN'T THROW ON A DUPLICATE KEY";
+        return false;
+    }
+
+    //objects bigger than the limit still come out whole (sorted up to the limit): "big" spills
+    //in the middle of "list", after its k keys went out sorted, which spills the top level too
+    json.set_canonical(true, JSON_File::DUPLICATES_THROW, 256);
+    json.set_hashing(false);
+    json.open("canonical.out.3");
+    json.print_element("b", true);
+    json.open_object("big");
+    for(int i=9;i>=0;i--){ json.print_element("k" + to_string(i), i); }
+    json.print_array("list", vector<int>(1000, 7));//spills in the middle of the member
+    json.close_object();
+    json.print_element("a", false);
+    if(json.close() != 0){
+        message = "JSON_File::close() RETURNED A HASH WITH HASHING OFF";
+        return false;
+    }
+
+    //every key is there, in order: b and big sorted before the spill, a streamed after it
+    JSON_Reader reader("canonical.out.3");
+    string file = reader.find("").str();
+    vector<string> keys = {"\"b\"", "\"big\"", "\"k0\""};
+    for(int i=1;i<=9;i++){ keys.push_back("\"k" + to_string(i) + "\""); }
+    keys.push_back("\"list\"");
+    keys.push_back("\"a\"");
+    size_t at = 0;
+    for(int i=0;i<keys.size() && at != string::npos;i++){ at = file.find(keys[i], at); }
+    vector<JSON_Value> values = reader.find({"/b", "/a", "/big/k0", "/big/k9", "/big/list/999", "/big/list/1000"});
+    if(at == string::npos || values[0].as_bool() != true || values[1].as_bool() != false
+       || values[2].as_long() != 0 || values[3].as_long() != 9
+       || values[4].as_long() != 7 || values[5].exists()){
+        message = "CANONICAL OUTPUT OVER THE SORT LIMIT LOST KEYS OR ORDER:\n" + file;
+        return false;
+    }
+
+    return true;
+}
+
+//Test path queries on the files written above (@RETURN SUCCESS)
+bool readerTest(string& message){
+    JSON_Reader reader("secondFile.out");
+
+    //one pass for all of them (out of file order on purpose)
+    vector<JSON_Value> values = reader.find({
+        "/binary (foobar)",
+        "/testing chaining!/test1.../test5 :)/2",
+        "/testing chaining!/test1.../test6 :)/3",
+        "/testing chaining!/test1.../test3 -- bad practice/0/2",
+        "/pair/0",
+        "/testing chaining!/test1.../test21 :)",
+        "/testing chaining!/missing",
+        "/.print_array({1, 2, 3})/3",
+        "/columns (batches of 2)/0/data/id/1"
+    });
+    vector<unsigned char> bytes;
+    if(!values[0].binary(bytes) || string(bytes.begin(), bytes.end()) != "foobar"
+       || values[1].type() != JSON_Value::BOOLEAN || values[1].as_bool() != false
+       || values[2].as_double() != 7.7
+       || values[3].as_long() != 5
+       || values[4].str() != "key"
+       || values[5].str() != "!!!!!!!!!!!!!!!!!!"
+       || values[6].exists() || values[7].exists()
+       || values[8].as_long() != 1){
+        message = "JSON_Reader RETURNED THE WRONG VALUES FROM secondFile.out.json";
+        return false;
+    }
+
+    //a lone lookup and a whole subtree
+    JSON_Value array = reader.find("/testing chaining!/test1.../test7 :)");
+    if(reader.find("/pair/1").as_long() != 2 || array.type() != JSON_Value::ARRAY
+       || array.str() != "[\n        \"my\", \"name\", \"is\", \"hard\"\n      ]"){
+        message = "JSON_Reader RETURNED THE WRONG VALUES FROM secondFile.out.json: " + array.str();
+        return false;
+    }
+    reader.close();
+
+    //escaped strings (quotes and brackets in them must not confuse the skipping), ".json" not doubled
+    reader.open("canonical.out.0.json");
+    values = reader.find({"/record/nested/y", "/record/a", "/count", "/record/list/2"});
+    if(values[0].as_double() != 0 || values[1].str() != "tab\there \"quoted\"" || values[2].as_long() != 7 || !values[3].is_null()){
+        message = "JSON_Reader RETURNED THE WRONG VALUES FROM canonical.out.0.json";
+        return false;
+    }
+
+    //skipping whole containers whose strings have \" \\ ] } in them, at every offset of a 64 byte block
+    reader.close();
+    JSON_File tricky;
+    tricky.set_canonical(true);
+    tricky.open("reader.out");
+    vector<string> hard;
+    for(int i=0;i<64;i++){ hard.push_back(string(i, 'x') + "\\\"]}\\" + (i % 2 ? "\\" : "\"}]")); }
+    tricky.open_object("skipped");
+    for(int i=0;i<hard.size();i++){ tricky.print_element("s" + to_string(i), hard[i]); }
+    tricky.close_object();
+    tricky.print_array("skipped array", hard);
+    tricky.print_element("after", 42);
+    tricky.close();
+
+    reader.open("reader.out");
+    JSON_Value after = reader.find("/after");//both containers skipped whole
+    values = reader.find({"/skipped array/63", "/skipped/s63"});//walked into
+    if(after.type() != JSON_Value::NUMBER || after.as_long() != 42 || values[0].str() != hard[63] || values[1].str() != hard[63]){
+        message = "JSON_Reader LOST ITS PLACE SKIPPING ESCAPED STRINGS IN reader.out.json";
+        return false;
+    }
+
+    //numbers longer than as_double()/as_long()'s stack buffer
+    reader.close();
+    string digits70 = "1" + string(69, '0'), long7 = "7." + string(70, '0');
+    ofstream numbers("reader.out.json");
+    numbers << "{\"big\": " << digits70 << ", \"seven\": " << long7 << "}\n";
+    numbers.close();
+    reader.open("reader.out");
+    vector<JSON_Value> longNumbers = reader.find({"/big", "/seven"});
+    if(longNumbers[0].as_double() != 1e69 || longNumbers[1].as_long() != 7 || longNumbers[1].as_double() != 7){
+        message = "JSON_Reader CUT OFF A NUMBER LONGER THAN 64 CHARACTERS";
+        return false;
+    }
+
+    //asking a string for a number
+    bool thrown = false;
+    try {
+        values[1].as_double();
+    } catch(JSON_Value::TYPE_ERROR* e){
+        thrown = (e->message.find("as_double()") != string::npos);
+        delete e;
+    }
+    if(!thrown){
+        message = "JSON_Value::as_double() DIDN'T THROW (NAMING ITSELF) ON A STRING";
+        return false;
+    }
+
+    return true;
+}
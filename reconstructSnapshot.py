@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""
+Author: Ethan Dickey
+
+Rebuilds snapshot k written by JSON_Snapshots (see JSON_Snapshots.h): loads the last
+keyframe <base>.<j>.full.json with j <= k, then applies <base>.<j+1>.delta.json ...
+<base>.<k>.delta.json as JSON Merge Patches (RFC 7386).
+
+usage: python3 reconstructSnapshot.py <base> <k> [output file]
+"""
+import json
+import os
+import sys
+
+
+def merge_patch(target, patch):
+    if not isinstance(patch, dict):
+        return patch
+    if not isinstance(target, dict):
+        target = {}
+    for key, value in patch.items():
+        if value is None:
+            target.pop(key, None)
+        else:
+            target[key] = merge_patch(target.get(key), value)
+    return target
+
+
+def reconstruct(base, k):
+    start = k
+    while start >= 0 and not os.path.exists("%s.%d.full.json" % (base, start)):
+        start -= 1
+    if start < 0:
+        sys.exit("no keyframe at or before snapshot %d for %s" % (k, base))
+
+    with open("%s.%d.full.json" % (base, start)) as f:
+        state = json.load(f)
+    for i in range(start + 1, k + 1):
+        with open("%s.%d.delta.json" % (base, i)) as f:
+            state = merge_patch(state, json.load(f))
+    return state
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        sys.exit(__doc__.strip())
+
+    state = reconstruct(sys.argv[1], int(sys.argv[2]))
+    if len(sys.argv) > 3:
+        with open(sys.argv[3], "w") as f:
+            json.dump(state, f, indent=2)
+    else:
+        print(json.dumps(state, indent=2))
@@ -1,5 +1,35 @@
 #!/bin/bash
 
+if [ "$1" = "bench" ]; then
+  # ./runProgram.sh bench [scale] [results file] -- extra compiler flags can go in $CXXFLAGS
+  g++ -std=c++11 -O2 $CXXFLAGS benchmark.cpp -o ./bench.out
+  ./bench.out ${2:-1} ${3:-benchResults.out}
+  exit
+fi
+
+if [ "$1" = "bench-stats" ]; then
+  # ./runProgram.sh bench-stats [scale] [rounds] -- JSON_FILE_STATS off vs on, runs alternate so
+  # both builds see the same machine state and are pinned to one CPU (BENCH_CPU, default 0) when
+  # taskset is there; the median of all rounds is compared per workload against the 2% limit,
+  # then the off build against itself to show how big the run to run noise is
+  g++ -std=c++11 -O2 $CXXFLAGS benchmark.cpp -o ./bench.out
+  g++ -std=c++11 -O2 $CXXFLAGS -DJSON_FILE_STATS=1 benchmark.cpp -o ./bench.stats.out
+  pin=""
+  if command -v taskset > /dev/null; then pin="taskset -c ${BENCH_CPU:-0}"; fi
+  off=""; on=""; offOdd=""; offEven=""
+  for i in $(seq 1 ${3:-8}); do
+    $pin ./bench.out ${2:-1} benchResults.off.$i > /dev/null
+    $pin ./bench.stats.out ${2:-1} benchResults.on.$i > /dev/null
+    off="$off,benchResults.off.$i.json"; on="$on,benchResults.on.$i.json"
+    if [ $((i % 2)) = 1 ]; then offOdd="$offOdd,benchResults.off.$i.json"; else offEven="$offEven,benchResults.off.$i.json"; fi
+  done
+  python3 compareBench.py --limit 2 ${off#,} ${on#,} "stats off" "stats on"
+  # the same build against itself (odd vs even rounds): deltas this size are noise
+  echo -e "\nNoise floor:"
+  python3 compareBench.py ${offOdd#,} ${offEven#,} "off (odd)" "off (even)"
+  exit
+fi
+
 g++ -std=c++11 main.cpp -o ./a.out
 if [ "$1" = "runcode" ]; then
   ./a.out